@@ -0,0 +1,225 @@
+/* ----------------------------------------------------------------------------
+ * @file ARENA.C
+ * @author Si Xun Li - 260674916
+ * @version 1.0
+ * @brief This file contains a bump allocator with power-of-two size classes.
+ *        Blocks are carved out of large chunks and returned blocks are kept
+ *        on a free list per size class so that they can be reused. Requests
+ *        larger than the biggest class go straight to malloc.
+ * ----------------------------------------------------------------------------
+ */
+
+#include <stdlib.h>
+#include "arena.h"
+#include "constant.h"
+
+/*
+ * A free block is reused to link the free list of its size class
+ */
+typedef struct free_block free_block_t;
+struct free_block {
+	free_block_t *next;
+};
+
+typedef struct chunk chunk_t;
+struct chunk {
+	chunk_t *next;
+	size_t used;
+	size_t size;
+};
+
+typedef struct arena arena_t;
+struct arena {
+	chunk_t *chunks;
+	free_block_t *free_lists[ARENA_CLASS_COUNT];
+	arena_stats_t stats;
+};
+
+arena_t arena;
+
+/*
+ * Private functions
+ */
+int size_class(size_t size);
+void *bump(size_t size);
+
+/* ----------------------------------------------------------------------------
+ * @brief Initializes the arena. No chunk is reserved until the first
+ *        allocation.
+ * ----------------------------------------------------------------------------
+ */
+void init_arena() {
+	int i;
+	arena.chunks = NULL;
+	for (i = 0; i < ARENA_CLASS_COUNT; i++) {
+		arena.free_lists[i] = NULL;
+	}
+}
+
+/* ----------------------------------------------------------------------------
+ * @brief Returns the size class of a request.
+ * @param input  - size - Number of bytes requested
+ * @return The index of the smallest class that fits the request. -1 if the
+ *         request is larger than the biggest class
+ * ----------------------------------------------------------------------------
+ */
+int size_class(size_t size) {
+	int i;
+	size_t class_size = ARENA_MIN_CLASS;
+
+	for (i = 0; i < ARENA_CLASS_COUNT; i++) {
+		if (size <= class_size) {
+			return i;
+		}
+		class_size = class_size << 1;
+	}
+	return -1;
+}
+
+/* ----------------------------------------------------------------------------
+ * @brief Carves a block out of the current chunk. A new chunk is reserved if
+ *        the current one cannot fit the block.
+ * @param input  - size - Size of the block, a multiple of the minimum class
+ * @return A pointer to the block. NULL if a chunk could not be reserved
+ * ----------------------------------------------------------------------------
+ */
+void *bump(size_t size) {
+	chunk_t *chunk = arena.chunks;
+	void *block;
+
+	if (!chunk || chunk->size - chunk->used < size) {
+		chunk = (chunk_t *) malloc(ARENA_CHUNK_SIZE);
+		if (!chunk) {
+			return NULL;
+		}
+		// Keep blocks aligned to the minimum class
+		chunk->used = (sizeof(chunk_t) + ARENA_MIN_CLASS - 1) &
+		              ~((size_t) ARENA_MIN_CLASS - 1);
+		chunk->size = ARENA_CHUNK_SIZE;
+		chunk->next = arena.chunks;
+		arena.chunks = chunk;
+
+		arena.stats.bytes_reserved += ARENA_CHUNK_SIZE;
+		arena.stats.bytes_unused += ARENA_CHUNK_SIZE - chunk->used;
+	}
+
+	block = (char *) chunk + chunk->used;
+	chunk->used += size;
+	arena.stats.bytes_unused -= size;
+	return block;
+}
+
+/* ----------------------------------------------------------------------------
+ * @brief Allocates a block of at least the requested size.
+ * @param input  - size - Number of bytes requested
+ * @return A pointer to the block. NULL if memory could not be allocated
+ * ----------------------------------------------------------------------------
+ */
+void *arena_alloc(size_t size) {
+	int class_index;
+	size_t capacity;
+	void *block;
+
+	class_index = size_class(size);
+	if (class_index == -1) {
+		// Too large for the arena
+		block = malloc(size);
+		capacity = size;
+		if (block) {
+			arena.stats.bytes_reserved += size;
+		}
+	} else {
+		capacity = (size_t) ARENA_MIN_CLASS << class_index;
+		if (arena.free_lists[class_index]) {
+			// Reuse a returned block of the same class
+			block = arena.free_lists[class_index];
+			arena.free_lists[class_index] =
+			    arena.free_lists[class_index]->next;
+			arena.stats.bytes_free_listed -= capacity;
+			arena.stats.blocks_reused++;
+		} else {
+			block = bump(capacity);
+		}
+	}
+
+	if (block) {
+		arena.stats.bytes_live += size;
+		arena.stats.bytes_rounding += capacity - size;
+		arena.stats.blocks_live++;
+	}
+	return block;
+}
+
+/* ----------------------------------------------------------------------------
+ * @brief Returns a block to the arena.
+ * @param input  - block - A block returned by arena_alloc
+ *        input  - size  - The size that was requested for the block
+ * ----------------------------------------------------------------------------
+ */
+void arena_free(void *block, size_t size) {
+	int class_index;
+	size_t capacity;
+	free_block_t *free_block;
+
+	if (!block) {
+		return;
+	}
+
+	class_index = size_class(size);
+	if (class_index == -1) {
+		free(block);
+		capacity = size;
+		arena.stats.bytes_reserved -= size;
+	} else {
+		capacity = (size_t) ARENA_MIN_CLASS << class_index;
+		free_block = (free_block_t *) block;
+		free_block->next = arena.free_lists[class_index];
+		arena.free_lists[class_index] = free_block;
+		arena.stats.bytes_free_listed += capacity;
+	}
+
+	arena.stats.bytes_live -= size;
+	arena.stats.bytes_rounding -= capacity - size;
+	arena.stats.blocks_live--;
+}
+
+/* ----------------------------------------------------------------------------
+ * @brief Returns a block able to hold a new size. The block is kept if the new
+ *        size falls in the same class, which is the common case when a value
+ *        is overwritten. The contents are not preserved otherwise.
+ * @param input  - block    - A block returned by arena_alloc
+ *        input  - old_size - The size that was requested for the block
+ *        input  - new_size - The new size to hold
+ * @return A pointer to the block. NULL if memory could not be allocated, in
+ *         which case the original block is left untouched
+ * ----------------------------------------------------------------------------
+ */
+void *arena_resize(void *block, size_t old_size, size_t new_size) {
+	int class_index;
+	void *new_block;
+
+	class_index = size_class(old_size);
+	if (block && class_index != -1 && class_index == size_class(new_size)) {
+		arena.stats.bytes_live += new_size - old_size;
+		arena.stats.bytes_rounding -= new_size - old_size;
+		arena.stats.blocks_reused++;
+		return block;
+	}
+
+	new_block = arena_alloc(new_size);
+	if (new_block) {
+		arena_free(block, old_size);
+	}
+	return new_block;
+}
+
+/* ----------------------------------------------------------------------------
+ * @brief Copies the usage counters of the arena.
+ * @param output - stats - Counters to overwrite
+ * ----------------------------------------------------------------------------
+ */
+void arena_get_stats(arena_stats_t *stats) {
+	if (stats) {
+		*stats = arena.stats;
+	}
+}
@@ -0,0 +1,35 @@
+/* ----------------------------------------------------------------------------
+ * @file ARENA.H
+ * @author Si Xun Li - 260674916
+ * @version 1.0
+ * @brief This file is the header for the string arena used by shell memory.
+ * ----------------------------------------------------------------------------
+ */
+
+#include <stddef.h>
+
+/*
+ * Arena usage counters
+ */
+#ifndef ARENA_H
+#define ARENA_H
+typedef struct arena_stats arena_stats_t;
+struct arena_stats {
+	size_t bytes_live;
+	size_t bytes_rounding;
+	size_t bytes_free_listed;
+	size_t bytes_unused;
+	size_t bytes_reserved;
+	size_t blocks_live;
+	size_t blocks_reused;
+};
+#endif
+
+/*
+ * Available functions for the arena
+ */
+void init_arena();
+void *arena_alloc(size_t size);
+void arena_free(void *block, size_t size);
+void *arena_resize(void *block, size_t old_size, size_t new_size);
+void arena_get_stats(arena_stats_t *stats);
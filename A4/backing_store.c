@@ -0,0 +1,508 @@
+/* ----------------------------------------------------------------------------
+ * @file BACKING_STORE.C
+ * @author Si Xun Li - 260674916
+ * @version 1.0
+ * @brief This file contains the backing store. A script is stored under the
+ *        hash of its content next to the index of its compiled program, so a
+ *        script launched again, during this boot or a later one, is neither
+ *        compiled nor copied. The store is kept across boots and its least
+ *        recently used entries are collected once it grows past its limit.
+ *        An entry is made of two files:
+ *            - <hash>.txt - The script, read by the processes running it
+ *            - <hash>.idx - The index of its program, whose last
+ *                           modification is the last use of the entry
+ * ----------------------------------------------------------------------------
+ */
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <pthread.h>
+#include <sys/stat.h>
+#include <sys/ioctl.h>
+#include <sys/sendfile.h>
+#include <linux/fs.h>
+#include "backing_store.h"
+#include "kernel.h"
+#include "constant.h"
+
+/*
+ * Entry found while the store is collected
+ */
+typedef struct store_entry store_entry_t;
+struct store_entry {
+	unsigned long long content_hash;
+	off_t size;
+	struct timespec used;
+};
+
+// Set when the kernel boots
+off_t store_limit = (off_t) DEFAULT_BACKING_STORE_LIMIT * 1024;
+
+/*
+ * Guards the size of the store while it is collected. Entries are added
+ * without the lock by renaming them into place.
+ */
+pthread_mutex_t store_lock = PTHREAD_MUTEX_INITIALIZER;
+off_t store_size = 0;
+
+// Temporary files are numbered in creation order
+int temporary_files = 0;
+
+/*
+ * Functions specific to backing_store.c
+ */
+void entry_path(char *path, unsigned long long content_hash, char *extension);
+int parse_entry_name(char *name, unsigned long long *content_hash,
+                     char **extension);
+int compare_entries(const void *a, const void *b);
+void collect_backing_store(int booting);
+FILE *open_entry(program_t *program);
+int hash_file(int fd, off_t size, unsigned long long *content_hash);
+int copy_file(int source, int target, off_t size);
+int populate_backing_file(int source, char *backing_filename);
+int store_program(int source, program_t *program);
+
+/* ----------------------------------------------------------------------------
+ * @brief Sets the size the backing store may grow to. Must be called before
+ *        init_backing_store.
+ * @param input  - kilobytes - The limit of the store
+ * @return int - Status code
+ *                  0 - No errors
+ *                 -1 - The limit is not positive
+ * ----------------------------------------------------------------------------
+ */
+int configure_backing_store(int kilobytes) {
+	if (kilobytes < 1) {
+		return -1;
+	}
+	store_limit = (off_t) kilobytes * 1024;
+	return 0;
+}
+
+/* ----------------------------------------------------------------------------
+ * @brief Creates the backing store if it does not exist, then removes the
+ *        files left by an interrupted launch and the entries exceeding the
+ *        limit of the store.
+ * @return int - Status code
+ *                  0 - No errors
+ *                 -1 - The backing store could not be created
+ * ----------------------------------------------------------------------------
+ */
+int init_backing_store() {
+	if (mkdir(BACKING_STORE_NAME, 0755) != 0 && errno != EEXIST) {
+		return -1;
+	}
+	if (access(BACKING_STORE_NAME, W_OK | X_OK) != 0) {
+		return -1;
+	}
+	collect_backing_store(1);
+	return 0;
+}
+
+/* ----------------------------------------------------------------------------
+ * @brief Writes the path of a file of an entry.
+ * @param output - path         - A buffer of MAX_FILENAME_LENGTH characters
+ *        input  - content_hash - The hash of the script
+ *        input  - extension    - "txt" or "idx"
+ * ----------------------------------------------------------------------------
+ */
+void entry_path(char *path, unsigned long long content_hash, char *extension) {
+	snprintf(path, MAX_FILENAME_LENGTH, BACKING_STORE_NAME "/%016llx.%s",
+	         content_hash, extension);
+}
+
+/* ----------------------------------------------------------------------------
+ * @brief Reads the name of a file of an entry.
+ * @param input  - name         - The name of a file of the store
+ *        output - content_hash - The hash of the script
+ *        output - extension    - "txt" or "idx"
+ * @return int - Status code
+ *                  0 - No errors
+ *                 -1 - The file is not part of an entry
+ * ----------------------------------------------------------------------------
+ */
+int parse_entry_name(char *name, unsigned long long *content_hash,
+                     char **extension) {
+	char *end;
+	int i;
+
+	for (i = 0; i < 16; i++) {
+		if (name[i] == '\0' || !strchr("0123456789abcdef", name[i])) {
+			return -1;
+		}
+	}
+	*content_hash = strtoull(name, &end, 16);
+	if (end != name + 16 ||
+	    (strcmp(end, ".txt") != 0 && strcmp(end, ".idx") != 0)) {
+		return -1;
+	}
+	*extension = end + 1;
+	return 0;
+}
+
+/* ----------------------------------------------------------------------------
+ * @brief Orders entries from the least to the most recently used.
+ * ----------------------------------------------------------------------------
+ */
+int compare_entries(const void *a, const void *b) {
+	const struct timespec *x = &((const store_entry_t *) a)->used;
+	const struct timespec *y = &((const store_entry_t *) b)->used;
+
+	if (x->tv_sec != y->tv_sec) {
+		return x->tv_sec < y->tv_sec ? -1 : 1;
+	}
+	return (x->tv_nsec > y->tv_nsec) - (x->tv_nsec < y->tv_nsec);
+}
+
+/* ----------------------------------------------------------------------------
+ * @brief Removes the least recently used entries until the store fits in its
+ *        limit, or in part of it while the kernel runs so that the store is
+ *        not collected again by the next launch. Processes reading a removed
+ *        entry keep it open. The index is removed first so that the script
+ *        of an entry is never found without it.
+ * @param input  - booting - 1 to also remove the files that are not part of a
+ *                           complete entry, which may only be done before any
+ *                           script is launched
+ * ----------------------------------------------------------------------------
+ */
+void collect_backing_store(int booting) {
+	char text_path[MAX_FILENAME_LENGTH];
+	char path[MAX_FILENAME_LENGTH];
+	unsigned long long content_hash;
+	store_entry_t *entries = NULL;
+	struct dirent *file;
+	struct stat text, index;
+	off_t total, target;
+	char *extension;
+	int count = 0, capacity = 0, i;
+	DIR *dir;
+
+	pthread_mutex_lock(&store_lock);
+	dir = opendir(BACKING_STORE_NAME);
+	if (!dir) {
+		pthread_mutex_unlock(&store_lock);
+		return;
+	}
+
+	total = 0;
+	while ((file = readdir(dir))) {
+		if (strcmp(file->d_name, ".") == 0 ||
+		    strcmp(file->d_name, "..") == 0) {
+			continue;
+		}
+		if (parse_entry_name(file->d_name, &content_hash, &extension) != 0) {
+			// Temporary files and files of earlier versions
+			if (booting) {
+				unlinkat(dirfd(dir), file->d_name, 0);
+			}
+			continue;
+		}
+		entry_path(text_path, content_hash, "txt");
+		entry_path(path, content_hash, "idx");
+		if (stat(text_path, &text) != 0 || stat(path, &index) != 0) {
+			if (booting) {
+				unlinkat(dirfd(dir), file->d_name, 0);
+			}
+			continue;
+		}
+
+		// Each entry is listed once, through its index
+		if (strcmp(extension, "idx") != 0) {
+			continue;
+		}
+		if (reserve((void **) &entries, &capacity, count + 1,
+		            sizeof(store_entry_t)) != 0) {
+			break;
+		}
+		entries[count].content_hash = content_hash;
+		entries[count].size = text.st_size + index.st_size;
+		entries[count].used = index.st_mtim;
+		total += entries[count].size;
+		count++;
+	}
+	closedir(dir);
+
+	target = booting ? store_limit :
+	         store_limit / BACKING_STORE_KEEP_DEN * BACKING_STORE_KEEP_NUM;
+	if (total > target) {
+		qsort(entries, count, sizeof(store_entry_t), compare_entries);
+		for (i = 0; i < count && total > target; i++) {
+			entry_path(path, entries[i].content_hash, "idx");
+			unlink(path);
+			entry_path(path, entries[i].content_hash, "txt");
+			unlink(path);
+			total -= entries[i].size;
+		}
+	}
+	store_size = total;
+	pthread_mutex_unlock(&store_lock);
+	free(entries);
+}
+
+/* ----------------------------------------------------------------------------
+ * @brief Opens the script of the entry of a program and marks the entry as
+ *        used.
+ * @param input  - program - A compiled program
+ * @return A file pointer. NULL if the entry was collected or does not match
+ *         the program
+ * ----------------------------------------------------------------------------
+ */
+FILE *open_entry(program_t *program) {
+	char path[MAX_FILENAME_LENGTH];
+	struct stat text;
+	FILE *file;
+
+	entry_path(path, program->content_hash, "txt");
+	file = fopen(path, "r");
+	if (!file) {
+		return NULL;
+	}
+	if (fstat(fileno(file), &text) != 0 ||
+	    text.st_size != program->text_size) {
+		fclose(file);
+		return NULL;
+	}
+
+	// The script may be linked elsewhere, so the use goes on the index
+	entry_path(path, program->content_hash, "idx");
+	utimensat(AT_FDCWD, path, NULL, 0);
+	return file;
+}
+
+/* ----------------------------------------------------------------------------
+ * @brief Hashes the content of a file.
+ * @param input  - fd           - The descriptor of the file
+ *        input  - size         - The size of the file
+ *        output - content_hash - The hash of the file
+ * @return int - Status code
+ *                  0 - No errors
+ *                 -1 - The file could not be read
+ * ----------------------------------------------------------------------------
+ */
+int hash_file(int fd, off_t size, unsigned long long *content_hash) {
+	char buffer[COPY_BUFFER_SIZE];
+	off_t offset;
+	ssize_t count;
+
+	*content_hash = CONTENT_HASH_SEED;
+	for (offset = 0; offset < size; offset += count) {
+		count = pread(fd, buffer, COPY_BUFFER_SIZE, offset);
+		if (count <= 0) {
+			return -1;
+		}
+		*content_hash = hash_text(buffer, count, *content_hash);
+	}
+	return 0;
+}
+
+/* ----------------------------------------------------------------------------
+ * @brief Copies a file within the kernel. copy_file_range is tried first,
+ *        then sendfile, then reads and writes through a buffer for the rest
+ *        of the file.
+ * @param input  - source - The descriptor of the file to copy
+ *        input  - target - The descriptor of the copy
+ *        input  - size   - The size of the file
+ * @return int - Status code
+ *                  0 - No errors
+ *                 -1 - The file could not be copied
+ * ----------------------------------------------------------------------------
+ */
+int copy_file(int source, int target, off_t size) {
+	char buffer[COPY_BUFFER_SIZE];
+	off_t offset = 0;
+	ssize_t copied, written, count;
+
+	while (offset < size) {
+		copied = copy_file_range(source, &offset, target, NULL,
+		                         size - offset, 0);
+		if (copied <= 0) {
+			break;
+		}
+	}
+	while (offset < size) {
+		copied = sendfile(target, source, &offset, size - offset);
+		if (copied <= 0) {
+			break;
+		}
+	}
+	while (offset < size) {
+		copied = pread(source, buffer, COPY_BUFFER_SIZE, offset);
+		if (copied <= 0) {
+			return -1;
+		}
+		for (written = 0; written < copied; ) {
+			count = write(target, buffer + written, copied - written);
+			if (count <= 0) {
+				return -1;
+			}
+			written += count;
+		}
+		offset += copied;
+	}
+	return 0;
+}
+
+/* ----------------------------------------------------------------------------
+ * @brief Copies a file to the backing store. The copy shares the blocks of
+ *        the file if the file system allows it and is copied within the
+ *        kernel if not. Scripts are never linked since an entry outlives the
+ *        process and the script could be edited in place.
+ * @param input  - source           - The descriptor of the file
+ *        input  - backing_filename - The path in the backing store
+ * @return int - Status code
+ *                  0 - No errors
+ *                 -1 - The file could not be put in the backing store
+ * ----------------------------------------------------------------------------
+ */
+int populate_backing_file(int source, char *backing_filename) {
+	struct stat source_stat;
+	int target, err;
+
+	if (fstat(source, &source_stat) != 0) {
+		return -1;
+	}
+
+	target = open(backing_filename, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if (target < 0) {
+		return -1;
+	}
+	err = 0;
+#ifdef FICLONE
+	if (ioctl(target, FICLONE, source) != 0)
+#endif
+	{
+		err = copy_file(source, target, source_stat.st_size);
+	}
+	close(target);
+	return err;
+}
+
+/* ----------------------------------------------------------------------------
+ * @brief Adds the entry of a program to the backing store. Its files are
+ *        written under temporary names and renamed into place, so another
+ *        launch never finds a partial entry. The copy is hashed since the
+ *        script may have changed after it was compiled.
+ * @param input  - source  - The descriptor of the script
+ *        input  - program - The compiled script
+ * @return int - Status code
+ *                  0 - No errors
+ *                 -1 - The entry could not be written or the script changed
+ * ----------------------------------------------------------------------------
+ */
+int store_program(int source, program_t *program) {
+	char text_path[MAX_FILENAME_LENGTH];
+	char index_path[MAX_FILENAME_LENGTH];
+	char path[MAX_FILENAME_LENGTH];
+	unsigned long long content_hash;
+	struct stat text, index;
+	int number, fd, err;
+
+	number = __atomic_fetch_add(&temporary_files, 1, __ATOMIC_RELAXED);
+	snprintf(text_path, MAX_FILENAME_LENGTH,
+	         BACKING_STORE_NAME "/tmp.%d.%d.txt", (int) getpid(), number);
+	snprintf(index_path, MAX_FILENAME_LENGTH,
+	         BACKING_STORE_NAME "/tmp.%d.%d.idx", (int) getpid(), number);
+
+	err = populate_backing_file(source, text_path);
+	fd = err == 0 ? open(text_path, O_RDONLY) : -1;
+	if (fd < 0 || fstat(fd, &text) != 0 ||
+	    text.st_size != program->text_size ||
+	    hash_file(fd, text.st_size, &content_hash) != 0 ||
+	    content_hash != program->content_hash ||
+	    save_program_index(program, index_path) != 0 ||
+	    stat(index_path, &index) != 0) {
+		err = -1;
+	}
+	if (fd >= 0) {
+		close(fd);
+	}
+
+	if (err == 0) {
+		entry_path(path, program->content_hash, "txt");
+		err = rename(text_path, path);
+	}
+	if (err == 0) {
+		entry_path(path, program->content_hash, "idx");
+		err = rename(index_path, path);
+	}
+	if (err != 0) {
+		unlink(text_path);
+		unlink(index_path);
+		return -1;
+	}
+
+	pthread_mutex_lock(&store_lock);
+	store_size += text.st_size + index.st_size;
+	err = store_size > store_limit;
+	pthread_mutex_unlock(&store_lock);
+	if (err) {
+		collect_backing_store(0);
+	}
+	return 0;
+}
+
+/* ----------------------------------------------------------------------------
+ * @brief Finds the compiled program of a script and opens its copy in the
+ *        backing store. A script not modified since it was last launched
+ *        reuses its program, otherwise its content is hashed and its entry
+ *        loaded. The script is only compiled and copied if the store holds no
+ *        entry for its content.
+ * @param input  - file     - The script
+ *        input  - filename - The path the script was opened from
+ *        output - program  - The retained program of the script
+ * @return A file pointer on the copy. NULL if the script could not be
+ *         compiled or stored
+ * ----------------------------------------------------------------------------
+ */
+FILE *open_backing_file(FILE *file, char *filename, program_t **program) {
+	char index_path[MAX_FILENAME_LENGTH];
+	program_t *script, *compiled;
+	FILE *backing_file;
+
+	// Reuse the compiled program if the script was not modified. Its entry
+	// may have been collected since
+	backing_file = NULL;
+	compiled = find_program(filename);
+	if (compiled) {
+		backing_file = open_entry(compiled);
+	} else {
+		script = create_program(filename);
+		if (!script || read_program_text(script, fileno(file)) != 0) {
+			release_program(script);
+			return NULL;
+		}
+
+		// The entry is written again if its index cannot be loaded
+		entry_path(index_path, script->content_hash, "idx");
+		if (load_program_index(script, index_path) == 0) {
+			compiled = script;
+			backing_file = open_entry(compiled);
+		} else {
+			compiled = compile_text(filename, script->text,
+			                        script->text_size);
+			release_program(script);
+			if (!compiled) {
+				return NULL;
+			}
+		}
+		cache_program(compiled);
+	}
+
+	if (backing_file) {
+		__atomic_add_fetch(&counters.store_hits, 1, __ATOMIC_RELAXED);
+	} else if (store_program(fileno(file), compiled) == 0) {
+		__atomic_add_fetch(&counters.store_misses, 1, __ATOMIC_RELAXED);
+		backing_file = open_entry(compiled);
+	}
+	if (!backing_file) {
+		release_program(compiled);
+		return NULL;
+	}
+	*program = compiled;
+	return backing_file;
+}
@@ -0,0 +1,17 @@
+/* ----------------------------------------------------------------------------
+ * @file BACKING_STORE.H
+ * @author Si Xun Li - 260674916
+ * @version 1.0
+ * @brief This file is the header file for the backing store.
+ * ----------------------------------------------------------------------------
+ */
+
+#include <stdio.h>
+#include "program.h"
+
+/*
+ * Available functions for the backing store
+ */
+int configure_backing_store(int kilobytes);
+int init_backing_store();
+FILE *open_backing_file(FILE *file, char *filename, program_t **program);
@@ -0,0 +1,819 @@
+/* ----------------------------------------------------------------------------
+ * @file BENCHMARK.C
+ * @author Si Xun Li - 260674916
+ * @version 1.0
+ * @brief This file contains benchmarks of the simulator. They are run from
+ *        the shell with the bench command and report their results on the
+ *        console.
+ * ----------------------------------------------------------------------------
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <errno.h>
+#include <sys/stat.h>
+#include <pthread.h>
+#include "constant.h"
+#include "shell.h"
+#include "kernel.h"
+#include "cpu.h"
+#include "interpreter.h"
+#include "memorymanager.h"
+#include "console.h"
+#include "benchmark.h"
+#include "ready_queue.h"
+#include "policy.h"
+#include "replacement.h"
+
+/*
+ * Benchmarks
+ */
+int bench_tokenizer(int lines);
+int bench_workload(int processes, int lines, int *mix);
+int bench_queue(int max_threads, int operations);
+void *queue_worker(void *argument);
+int bench_sched(int max_cpus, int max_processes);
+void *sched_worker(void *argument);
+int bench_switch(int switches);
+int generate_script(char *filename, int lines, int *mix, unsigned int seed);
+
+/*
+ * Lines fed to the tokenizer benchmark, representative of exec scripts
+ */
+const char *SAMPLE_LINES[] = {
+	"set x 10\n",
+	"print x\n",
+	"mount test 20 15\n",
+	"write test.txt [I am testing this in 1 test.txt]\n",
+	"read test.txt s\n",
+	"  set greeting hello   world  \n"
+};
+const int SAMPLE_LINE_COUNT = sizeof(SAMPLE_LINES) / sizeof(char *);
+
+/*
+ * Keeps the compiler from discarding the benchmarked work
+ */
+volatile int bench_sink;
+
+/*
+ * Queue used before the ready ring, kept as the baseline of the queue
+ * benchmark: a linked list of malloc'd nodes behind a mutex
+ */
+typedef struct locked_node locked_node_t;
+struct locked_node {
+	pcb_t *pcb;
+	locked_node_t *next;
+};
+
+typedef struct locked_queue locked_queue_t;
+struct locked_queue {
+	pthread_mutex_t lock;
+	locked_node_t *first;
+	locked_node_t *last;
+};
+
+/*
+ * Work given to each thread of the queue benchmark
+ */
+typedef struct queue_work queue_work_t;
+struct queue_work {
+	ready_queue_t *ring;
+	locked_queue_t *locked;
+	pthread_barrier_t *start;
+	pcb_t *pcb;
+	int operations;
+};
+
+/*
+ * Work given to each simulated CPU of the scheduling benchmark
+ */
+typedef struct sched_work sched_work_t;
+struct sched_work {
+	int cpu_id;
+	int *stop;
+	unsigned long switches;
+	double cpu_time;
+};
+
+/*
+ * Mix of commands generated by default for the workload benchmark, in percent
+ * of set, print, read and write
+ */
+int DEFAULT_MIX[] = {40, 40, 10, 10};
+
+/* ----------------------------------------------------------------------------
+ * @brief Runs a benchmark. Every argument after the name of the benchmark
+ *        must be a number. Supports the following benchmarks
+ *            - tokenizer [<lines>]
+ *            - workload <processes> <lines> [<set> <print> <read> <write>]
+ *            - queue [<max_threads>] [<operations>]
+ *            - sched [<max_cpus>] [<max_processes>]
+ *            - switch [<switches>]
+ * @param input  - parsed_words - An array of strings
+ *        input  - num_of_words - Number of elements in the array
+ * @return int - Status code
+ *                  0 - No errors
+ *                 -7 - Unknown benchmark or invalid arguments
+ * ----------------------------------------------------------------------------
+ */
+int bench_cmd(char **parsed_words, int num_of_words, void *pcb, int is_cpu) {
+	int i, num_of_args;
+	int args[BENCH_MAX_ARGS];
+
+	num_of_args = num_of_words - 2;
+	for (i = 0; i < num_of_args; i++) {
+		if (i >= BENCH_MAX_ARGS || !is_number(parsed_words[i + 2])) {
+			num_of_args = -1;
+			break;
+		}
+		args[i] = atoi(parsed_words[i + 2]);
+	}
+
+	if (strcmp(parsed_words[1], "tokenizer") == 0 &&
+	    num_of_args >= 0 && num_of_args <= 1) {
+		return bench_tokenizer(num_of_args == 1 && args[0] > 0 ?
+		                       args[0] : 20000);
+	} else if (strcmp(parsed_words[1], "workload") == 0 &&
+	           (num_of_args == 2 || num_of_args == 6)) {
+		return bench_workload(args[0], args[1],
+		                      num_of_args == 6 ? &args[2] : DEFAULT_MIX);
+	} else if (strcmp(parsed_words[1], "queue") == 0 &&
+	           num_of_args >= 0 && num_of_args <= 2) {
+		return bench_queue(num_of_args >= 1 ? args[0] : 32,
+		                   num_of_args == 2 ? args[1] : 1000000);
+	} else if (strcmp(parsed_words[1], "sched") == 0 &&
+	           num_of_args >= 0 && num_of_args <= 2) {
+		return bench_sched(num_of_args >= 1 ? args[0] : 8,
+		                   num_of_args == 2 ? args[1] : 1024);
+	} else if (strcmp(parsed_words[1], "switch") == 0 &&
+	           num_of_args >= 0 && num_of_args <= 1) {
+		return bench_switch(num_of_args == 1 && args[0] > 0 ?
+		                    args[0] : 1000000);
+	}
+
+	printf(GENERIC_EXPECTED_MSG "bench tokenizer [<lines>]\n"
+	       TAB "bench workload <processes> <lines> "
+	       "[<set%%> <print%%> <read%%> <write%%>]\n"
+	       TAB "bench queue [<max_threads>] [<operations>]\n"
+	       TAB "bench sched [<max_cpus>] [<max_processes>]\n"
+	       TAB "bench switch [<switches>]\n");
+	return -7;
+}
+
+/* ----------------------------------------------------------------------------
+ * @brief Returns a monotonic timestamp.
+ * @return The time in seconds
+ * ----------------------------------------------------------------------------
+ */
+double now_seconds() {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* ----------------------------------------------------------------------------
+ * @brief Compares the line splitting done before executing a line. The legacy
+ *        path allocates a word array per line and copies every word with
+ *        trim and parser. The prompt splits its line in place with tokenize.
+ *        A CPU builds the words of a line in its instruction register from
+ *        the word offsets of the compiled program, as run_instruction does.
+ * @param input  - lines - Number of lines to split with each method
+ * @return int - Status code
+ *                  0 - No errors
+ *                 -8 - The sample lines could not be compiled
+ * ----------------------------------------------------------------------------
+ */
+int bench_tokenizer(int lines) {
+	int i, j, len;
+	char line[MAX_CMD_LENGTH];
+	char trimmed[MAX_CMD_LENGTH];
+	char filename[MAX_FILENAME_LENGTH];
+	char **legacy_words;
+	char *words[MAX_WORDS];
+	program_t *program;
+	instruction_t *instruction;
+	word_t *word;
+	FILE *file;
+	double start, legacy_time, tokenize_time, compiled_time;
+
+	start = now_seconds();
+	for (i = 0; i < lines; i++) {
+		const char *sample = SAMPLE_LINES[i % SAMPLE_LINE_COUNT];
+		legacy_words = malloc(sizeof(char *) * MAX_WORDS);
+		for (j = 0; j < MAX_WORDS; j++) {
+			legacy_words[j] = malloc(MAX_CMD_LENGTH);
+		}
+		len = trim(sample, strlen(sample), trimmed);
+		if (len > 0) {
+			bench_sink += parser(trimmed, legacy_words);
+		}
+		for (j = 0; j < MAX_WORDS; j++) {
+			free(legacy_words[j]);
+		}
+		free(legacy_words);
+	}
+	legacy_time = now_seconds() - start;
+
+	start = now_seconds();
+	for (i = 0; i < lines; i++) {
+		// Mimic the fetch into the instruction register
+		strcpy(line, SAMPLE_LINES[i % SAMPLE_LINE_COUNT]);
+		bench_sink += tokenize(line, words, MAX_WORDS);
+	}
+	tokenize_time = now_seconds() - start;
+
+	// The sample lines compiled like a script
+	if (mkdir(BENCH_FOLDER_NAME, 0755) != 0 && errno != EEXIST) {
+		printf(GENERIC_ERROR_MSG "cannot create %s\n", BENCH_FOLDER_NAME);
+		return -8;
+	}
+	sprintf(filename, BENCH_FOLDER_NAME "/tokenizer.txt");
+	file = fopen(filename, "w");
+	if (!file) {
+		printf(GENERIC_ERROR_MSG "cannot create %s\n", filename);
+		return -8;
+	}
+	for (i = 0; i < SAMPLE_LINE_COUNT; i++) {
+		fputs(SAMPLE_LINES[i], file);
+	}
+	fclose(file);
+	program = load_program(filename);
+	if (!program) {
+		printf(GENERIC_ERROR_MSG "cannot compile %s\n", filename);
+		return -8;
+	}
+
+	start = now_seconds();
+	for (i = 0; i < lines; i++) {
+		instruction = &program->code[i % program->line_count];
+		memcpy(line, program->text + instruction->line_offset,
+		       instruction->line_length);
+		for (j = 0; j < instruction->word_count; j++) {
+			word = &program->words[instruction->first_word + j];
+			words[j] = line + word->offset;
+			words[j][word->length] = '\0';
+		}
+		bench_sink += instruction->word_count;
+	}
+	compiled_time = now_seconds() - start;
+	release_program(program);
+
+	printf("Tokenizer benchmark (%d lines)\n"
+	       TAB "legacy trim+parser: %12.0f lines/sec\n"
+	       TAB "in-place tokenize:  %12.0f lines/sec (prompt)\n"
+	       TAB "compiled words:     %12.0f lines/sec (CPU)\n"
+	       TAB "speedup:            %12.1fx prompt, %.1fx CPU\n",
+	       lines,
+	       lines / legacy_time,
+	       lines / tokenize_time,
+	       lines / compiled_time,
+	       legacy_time / tokenize_time,
+	       legacy_time / compiled_time);
+	return 0;
+}
+
+/* ----------------------------------------------------------------------------
+ * @brief Writes a synthetic exec script. Commands are drawn from the mix. A
+ *        variable is set before it is printed and a file is written before it
+ *        is read, so that every generated line succeeds.
+ * @param input  - filename - The script to create
+ *        input  - lines    - Number of lines of the script
+ *        input  - mix      - Weights of set, print, read and write
+ *        input  - seed     - Seed of the generator
+ * @return int - Status code
+ *                  0 - No errors
+ *                 -1 - The script could not be created
+ * ----------------------------------------------------------------------------
+ */
+int generate_script(char *filename, int lines, int *mix, unsigned int seed) {
+	int i, pick, total, slot;
+	int is_set[BENCH_VARIABLES] = {0};
+	int is_written[BENCH_FILES] = {0};
+	FILE *file;
+
+	file = fopen(filename, "w");
+	if (!file) {
+		return -1;
+	}
+
+	total = mix[0] + mix[1] + mix[2] + mix[3];
+	i = 0;
+	if (mix[2] + mix[3] > 0) {
+		fprintf(file, "mount %s %d %d\n", BENCH_PARTITION,
+		        BENCH_PARTITION_BLOCKS, BENCH_PARTITION_BLOCK_SIZE);
+		i++;
+	}
+
+	for (; i < lines; i++) {
+		pick = rand_r(&seed) % total;
+		if (pick < mix[0] + mix[1]) {
+			slot = rand_r(&seed) % BENCH_VARIABLES;
+			if (pick < mix[0] || !is_set[slot]) {
+				fprintf(file, "set v%d %u\n", slot, rand_r(&seed) % 1000);
+				is_set[slot] = 1;
+			} else {
+				fprintf(file, "print v%d\n", slot);
+			}
+		} else {
+			slot = rand_r(&seed) % BENCH_FILES;
+			if (pick >= mix[0] + mix[1] + mix[2] || !is_written[slot]) {
+				fprintf(file, "write f%d [w%u]\n", slot,
+				        rand_r(&seed) % 1000);
+				is_written[slot] = 1;
+			} else {
+				fprintf(file, "read f%d r%d\n", slot, slot);
+			}
+		}
+	}
+
+	fclose(file);
+	return 0;
+}
+
+/* ----------------------------------------------------------------------------
+ * @brief Generates a synthetic workload and runs it like exec: the scripts
+ *        are queued, admitted while the admission limit allows and run
+ *        through the scheduler, which admits the rest as processes finish.
+ *        Reports the time of the first admission, the rate of executed
+ *        lines, context switches, page faults and disk blocks transferred
+ *        while scheduling and the page hits of the page replacement policy.
+ *        Use with output quiet to leave the console out of the measure.
+ * @param input  - processes - Number of scripts to run
+ *        input  - lines     - Number of lines per script
+ *        input  - mix       - Weights of set, print, read and write
+ * @return int - Status code
+ *                  0 - No errors
+ *                 -7 - Invalid arguments or the scripts could not be created
+ *                 -8 - Processes are scheduled
+ * ----------------------------------------------------------------------------
+ */
+int bench_workload(int processes, int lines, int *mix) {
+	int i;
+	char filename[MAX_FILENAME_LENGTH];
+	kernel_counters_t before, after;
+	pcb_pool_stats_t pool_before, pool_after;
+	replacement_t replacement_before, replacement_after;
+	unsigned long store_hits, store_misses, launched;
+	double start, launch_time, run_time, busy_time;
+
+	// The scheduler of the workload would return at once
+	if (is_scheduling()) {
+		printf(GENERIC_ERROR_MSG "cannot run while processes are "
+		       "scheduled\n");
+		return -8;
+	}
+
+	if (processes <= 0 || lines <= 0 ||
+	    mix[0] < 0 || mix[1] < 0 || mix[2] < 0 || mix[3] < 0 ||
+	    mix[0] + mix[1] + mix[2] + mix[3] == 0) {
+		printf(GENERIC_ERROR_MSG "processes, lines and mix must be "
+		       "positive\n");
+		return -7;
+	}
+
+	if (mkdir(BENCH_FOLDER_NAME, 0755) != 0 && errno != EEXIST) {
+		printf(GENERIC_ERROR_MSG "cannot create %s\n", BENCH_FOLDER_NAME);
+		return -7;
+	}
+
+	// Generate every script before measuring
+	for (i = 0; i < processes; i++) {
+		sprintf(filename, BENCH_FOLDER_NAME "/bench_%d.txt", i);
+		if (generate_script(filename, lines, mix, i + 1) != 0) {
+			printf(GENERIC_ERROR_MSG "cannot create %s\n", filename);
+			return -7;
+		}
+	}
+
+	// Queue and admit the scripts like exec does
+	lock_frames();
+	get_pcb_pool_stats(&pool_before);
+	replacement_before = *get_replacement();
+	unlock_frames();
+	before = counters;
+	start = now_seconds();
+	for (i = 0; i < processes; i++) {
+		sprintf(filename, BENCH_FOLDER_NAME "/bench_%d.txt", i);
+		if (queue_script(filename) != 0) {
+			printf(GENERIC_ERROR_MSG "cannot queue %s\n", filename);
+			break;
+		}
+	}
+	admit_scripts();
+	launch_time = now_seconds() - start;
+
+	busy_time = get_cpu_busy_time();
+	start = now_seconds();
+	scheduler();
+	run_time = now_seconds() - start;
+	after = counters;
+	launched = after.processes_launched - before.processes_launched;
+	store_hits = after.store_hits - before.store_hits;
+	store_misses = after.store_misses - before.store_misses;
+	busy_time = get_cpu_busy_time() - busy_time;
+	lock_frames();
+	get_pcb_pool_stats(&pool_after);
+	replacement_after = *get_replacement();
+	unlock_frames();
+
+	printf("Workload benchmark (%lu processes launched of %d, %d lines, "
+	       "mix %d/%d/%d/%d, %d CPUs)\n"
+	       TAB "launch:           %12.6f s\n"
+	       TAB "run:              %12.6f s (CPUs busy %.1f%%)\n"
+	       TAB "lines:            %12lu (%.0f/sec)\n"
+	       TAB "context switches: %12lu (%.0f/sec, %lu stolen)\n"
+	       TAB "page faults:      %12lu (%.0f/sec)\n"
+	       TAB "page hits:        %12lu (%lu misses, %s)\n"
+	       TAB "pages ahead:      %12lu (%lu faults avoided)\n"
+	       TAB "pages shared:     %12lu\n"
+	       TAB "backing store:    %12lu hits (%lu misses)\n"
+	       TAB "disk blocks:      %12lu (%.0f/sec, %lu read, %lu written)\n"
+	       TAB "pcb pool:         %12lu hits (%lu misses, %lu allocated)\n",
+	       launched, processes, lines, mix[0], mix[1], mix[2], mix[3],
+	       get_cpu_count(),
+	       launch_time,
+	       run_time, busy_time * 100.0 / (run_time * get_cpu_count()),
+	       after.lines - before.lines,
+	       (after.lines - before.lines) / run_time,
+	       after.context_switches - before.context_switches,
+	       (after.context_switches - before.context_switches) / run_time,
+	       after.steals - before.steals,
+	       after.page_faults - before.page_faults,
+	       (after.page_faults - before.page_faults) / run_time,
+	       replacement_after.hits - replacement_before.hits,
+	       replacement_after.misses - replacement_before.misses,
+	       replacement_after.name,
+	       after.pages_prefetched - before.pages_prefetched,
+	       after.faults_avoided - before.faults_avoided,
+	       after.pages_shared - before.pages_shared,
+	       store_hits, store_misses,
+	       (after.blocks_read - before.blocks_read) +
+	       (after.blocks_written - before.blocks_written),
+	       ((after.blocks_read - before.blocks_read) +
+	        (after.blocks_written - before.blocks_written)) / run_time,
+	       after.blocks_read - before.blocks_read,
+	       after.blocks_written - before.blocks_written,
+	       pool_after.hits - pool_before.hits,
+	       pool_after.misses - pool_before.misses,
+	       pool_after.allocated);
+	flush_console();
+	return 0;
+}
+
+/* ----------------------------------------------------------------------------
+ * @brief Enqueues and dequeues a PCB in a loop on the queue of the work.
+ * @param input  - argument - The work of the thread
+ * @return NULL
+ * ----------------------------------------------------------------------------
+ */
+void *queue_worker(void *argument) {
+	queue_work_t *work = (queue_work_t *) argument;
+	locked_node_t *node;
+	int i;
+
+	for (i = 0; i < work->operations; i++) {
+		if (work->ring) {
+			while (enqueue_ready(work->ring, work->pcb) != 0);
+			while (!dequeue_ready(work->ring));
+		} else {
+			node = (locked_node_t *) malloc(sizeof(locked_node_t));
+			node->pcb = work->pcb;
+			node->next = NULL;
+			pthread_mutex_lock(&work->locked->lock);
+			if (!work->locked->first) {
+				work->locked->first = node;
+			} else {
+				work->locked->last->next = node;
+			}
+			work->locked->last = node;
+			pthread_mutex_unlock(&work->locked->lock);
+
+			pthread_mutex_lock(&work->locked->lock);
+			node = work->locked->first;
+			work->locked->first = node->next;
+			pthread_mutex_unlock(&work->locked->lock);
+			free(node);
+		}
+	}
+	return NULL;
+}
+
+/* ----------------------------------------------------------------------------
+ * @brief Measures the throughput of the ready queue against the locked list
+ *        it replaced. Each thread adds a PCB and removes one in a loop, for
+ *        1, 2, 4... threads up to the maximum. Every enqueue and dequeue is an
+ *        operation.
+ * @param input  - max_threads - Largest number of threads
+ *        input  - operations  - Number of operations of each run
+ * @return int - Status code
+ *                  0 - No errors
+ *                 -7 - Invalid arguments
+ *                 -8 - The benchmark could not be set up
+ * ----------------------------------------------------------------------------
+ */
+int bench_queue(int max_threads, int operations) {
+	pthread_t threads[MAX_CPUS];
+	queue_work_t work[MAX_CPUS];
+	pcb_t pcbs[MAX_CPUS];
+	locked_queue_t locked;
+	ready_queue_t *ring;
+	double start, rate[2];
+	int i, threads_count, method, started, err;
+
+	if (max_threads < 1 || max_threads > MAX_CPUS ||
+	    operations < 2 * max_threads) {
+		printf(GENERIC_ERROR_MSG "threads must be between 1 and %d and "
+		       "there must be 2 operations per thread\n", MAX_CPUS);
+		return -7;
+	}
+
+	ring = create_ready_queue(READY_QUEUE_CAPACITY);
+	if (!ring) {
+		printf(GENERIC_ERROR_MSG "cannot create the ready queue\n");
+		return -8;
+	}
+	pthread_mutex_init(&locked.lock, NULL);
+
+	printf("Ready queue benchmark (%d operations per run)\n"
+	       TAB "%7s %18s %18s\n",
+	       operations, "threads", "ring ops/sec", "locked ops/sec");
+	err = 0;
+	for (threads_count = 1; threads_count <= max_threads && err == 0;
+	     threads_count *= 2) {
+		for (method = 0; method < 2; method++) {
+			locked.first = NULL;
+			locked.last = NULL;
+			start = now_seconds();
+			for (started = 0; started < threads_count; started++) {
+				work[started].ring = method == 0 ? ring : NULL;
+				work[started].locked = &locked;
+				work[started].pcb = &pcbs[started];
+				work[started].operations = operations / 2 / threads_count;
+				if (pthread_create(&threads[started], NULL, queue_worker,
+				                   &work[started]) != 0) {
+					err = -8;
+					break;
+				}
+			}
+			for (i = 0; i < started; i++) {
+				pthread_join(threads[i], NULL);
+			}
+			rate[method] = 2.0 * (operations / 2 / threads_count) *
+			               threads_count / (now_seconds() - start);
+		}
+		if (err != 0) {
+			printf(GENERIC_ERROR_MSG "cannot create %d threads\n",
+			       threads_count);
+			break;
+		}
+		printf(TAB "%7d %18.0f %18.0f\n", threads_count, rate[0], rate[1]);
+		flush_console();
+	}
+
+	pthread_mutex_destroy(&locked.lock);
+	free_ready_queue(ring);
+	return err;
+}
+
+/* ----------------------------------------------------------------------------
+ * @brief Takes the next process and preempts it right away until told to
+ *        stop, like a CPU whose processes never execute a line.
+ * @param input  - argument - The work of the simulated CPU
+ * @return NULL
+ * ----------------------------------------------------------------------------
+ */
+void *sched_worker(void *argument) {
+	sched_work_t *work = (sched_work_t *) argument;
+	struct timespec ts;
+	pcb_t *pcb;
+
+	while (!__atomic_load_n(work->stop, __ATOMIC_RELAXED)) {
+		pcb = remove_from_ready(work->cpu_id);
+		if (pcb) {
+			// Count the whole quantum as run, as a CPU-bound process would
+			while (preempt_process(work->cpu_id, pcb,
+			                       get_policy()->quantum(pcb)) != 0);
+			work->switches++;
+		}
+	}
+
+	// Host CPU time, unaffected by more simulated CPUs than host cores
+	clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+	work->cpu_time = ts.tv_sec + ts.tv_nsec / 1e9;
+	return NULL;
+}
+
+/* ----------------------------------------------------------------------------
+ * @brief Measures the cost of a context switch in the scheduler: taking the
+ *        next process from the ready queue or a run queue, stealing when a
+ *        run queue is empty, and preempting it. Processes do not execute, so
+ *        the time is the scheduling overhead alone. It is measured in host
+ *        CPU time per switch. Runs with 1, 2, 4... CPUs and 16, 64, 256...
+ *        processes up to the maximums.
+ * @param input  - max_cpus      - Largest number of simulated CPUs
+ *        input  - max_processes - Largest number of processes
+ * @return int - Status code
+ *                  0 - No errors
+ *                 -7 - Invalid arguments
+ *                 -8 - The benchmark could not be set up
+ * ----------------------------------------------------------------------------
+ */
+int bench_sched(int max_cpus, int max_processes) {
+	pthread_t threads[MAX_CPUS];
+	sched_work_t work[MAX_CPUS];
+	pcb_t *pcbs;
+	int stop;
+	unsigned long switches, steals;
+	double cpu_time;
+	struct timespec duration = {0, BENCH_SCHED_NANOSECONDS};
+	int i, cpus, processes, started, err;
+
+	if (max_cpus < 1 || max_cpus > MAX_CPUS || max_processes < 1 ||
+	    max_processes > READY_QUEUE_CAPACITY) {
+		printf(GENERIC_ERROR_MSG "CPUs must be between 1 and %d and "
+		       "processes between 1 and %d\n",
+		       MAX_CPUS, READY_QUEUE_CAPACITY);
+		return -7;
+	}
+	if (is_scheduling()) {
+		printf(GENERIC_ERROR_MSG "cannot run while processes are "
+		       "scheduled\n");
+		return -8;
+	}
+
+	pcbs = (pcb_t *) calloc(max_processes, sizeof(pcb_t));
+	if (!pcbs) {
+		printf(GENERIC_ERROR_MSG "cannot allocate %d processes\n",
+		       max_processes);
+		return -8;
+	}
+
+	printf("Scheduling benchmark (%s, %.0f ms per run)\n"
+	       TAB "%5s %10s %14s %12s\n",
+	       get_policy()->name, BENCH_SCHED_NANOSECONDS / 1e6,
+	       "cpus", "processes", "ns/switch", "stolen");
+	err = 0;
+	for (cpus = 1; cpus <= max_cpus && err == 0; cpus *= 2) {
+		for (processes = 16; processes <= max_processes * 4 && err == 0;
+		     processes *= 4) {
+			if (processes > max_processes) {
+				// Finish on the maximum itself
+				if (processes / 4 == max_processes) {
+					break;
+				}
+				processes = max_processes;
+			}
+			if (processes < cpus) {
+				continue;
+			}
+
+			for (i = 0; i < processes; i++) {
+				add_to_ready(&pcbs[i]);
+			}
+			steals = counters.steals;
+			stop = 0;
+			for (started = 0; started < cpus; started++) {
+				work[started].cpu_id = started;
+				work[started].stop = &stop;
+				work[started].switches = 0;
+				if (pthread_create(&threads[started], NULL, sched_worker,
+				                   &work[started]) != 0) {
+					err = -8;
+					break;
+				}
+			}
+			nanosleep(&duration, NULL);
+			__atomic_store_n(&stop, 1, __ATOMIC_RELAXED);
+			switches = 0;
+			cpu_time = 0.0;
+			for (i = 0; i < started; i++) {
+				pthread_join(threads[i], NULL);
+				switches += work[i].switches;
+				cpu_time += work[i].cpu_time;
+			}
+			steals = counters.steals - steals;
+
+			// Take every process back from the queues
+			for (i = 0; i < MAX_CPUS; i++) {
+				while (remove_from_ready(i));
+			}
+
+			if (err != 0) {
+				printf(GENERIC_ERROR_MSG "cannot create %d threads\n", cpus);
+				break;
+			}
+			printf(TAB "%5d %10d %14.1f %12lu\n", cpus, processes,
+			       switches ? cpu_time * 1e9 / switches : 0.0, steals);
+			flush_console();
+		}
+	}
+
+	free(pcbs);
+	return err;
+}
+
+/* ----------------------------------------------------------------------------
+ * @brief Measures a context switch, which loads the frame and offset of the
+ *        next process into a CPU, and the load of a page on a fault, which
+ *        copies its lines into a frame. The load is compared with the stream
+ *        frames used to hold, duplicated from the process's file whose
+ *        position was saved and restored around it.
+ * @param input  - switches - Number of context switches and of page loads
+ * @return int - Status code
+ *                  0 - No errors
+ *                 -8 - The benchmark could not be set up
+ * ----------------------------------------------------------------------------
+ */
+int bench_switch(int switches) {
+	char filename[MAX_FILENAME_LENGTH];
+	pcb_t *pcbs;
+	program_t *program;
+	frame_t frame;
+	FILE *file, *page;
+	fpos_t pos;
+	unsigned long context_switches;
+	double start, switch_time, legacy_time, load_time;
+	int i, loads;
+
+	if (is_scheduling()) {
+		printf(GENERIC_ERROR_MSG "cannot run while processes are "
+		       "scheduled\n");
+		return -8;
+	}
+
+	pcbs = (pcb_t *) calloc(BENCH_SWITCH_PROCESSES, sizeof(pcb_t));
+	if (!pcbs) {
+		printf(GENERIC_ERROR_MSG "cannot allocate %d processes\n",
+		       BENCH_SWITCH_PROCESSES);
+		return -8;
+	}
+	for (i = 0; i < BENCH_SWITCH_PROCESSES; i++) {
+		pcbs[i].pc_frame = i % get_ram_size();
+		pcbs[i].pc_offset = i % get_page_size();
+	}
+
+	// The switches are not part of the kernel's counters
+	context_switches = counters.context_switches;
+	start = now_seconds();
+	for (i = 0; i < switches; i++) {
+		context_switch(0, &pcbs[i % BENCH_SWITCH_PROCESSES], 1);
+	}
+	switch_time = now_seconds() - start;
+	counters.context_switches = context_switches;
+	free(pcbs);
+
+	// Page loads go through a script of a few pages, like the backing store
+	if (mkdir(BENCH_FOLDER_NAME, 0755) != 0 && errno != EEXIST) {
+		printf(GENERIC_ERROR_MSG "cannot create %s\n", BENCH_FOLDER_NAME);
+		return -8;
+	}
+	sprintf(filename, BENCH_FOLDER_NAME "/switch.txt");
+	if (generate_script(filename, BENCH_SWITCH_PAGES * get_page_size(),
+	                    DEFAULT_MIX, 1) != 0 ||
+	    !(file = fopen(filename, "r"))) {
+		printf(GENERIC_ERROR_MSG "cannot create %s\n", filename);
+		return -8;
+	}
+	program = load_program(filename);
+	if (!program) {
+		fclose(file);
+		printf(GENERIC_ERROR_MSG "cannot compile %s\n", filename);
+		return -8;
+	}
+
+	// Page loads read from the disk, so fewer of them are measured
+	loads = switches / 100 > 0 ? switches / 100 : 1;
+	start = now_seconds();
+	for (i = 0; i < loads; i++) {
+		fgetpos(file, &pos);
+		page = fdopen(dup(fileno(file)), "r");
+		page = find_page(i % BENCH_SWITCH_PAGES + 1, page);
+		fclose(page);
+		fsetpos(file, &pos);
+	}
+	legacy_time = now_seconds() - start;
+
+	memset(&frame, 0, sizeof(frame_t));
+	start = now_seconds();
+	for (i = 0; i < loads; i++) {
+		read_page(&frame, file, program, i % BENCH_SWITCH_PAGES + 1);
+	}
+	load_time = now_seconds() - start;
+	release_program(program);
+	fclose(file);
+	free(frame.text);
+	free(frame.lines);
+
+	printf("Context switch benchmark (%d switches, %d page loads)\n"
+	       TAB "context switch:             %10.1f ns\n"
+	       TAB "page load into a stream:    %10.1f ns\n"
+	       TAB "page load into a frame:     %10.1f ns\n",
+	       switches, loads,
+	       switch_time * 1e9 / switches,
+	       legacy_time * 1e9 / loads,
+	       load_time * 1e9 / loads);
+	return 0;
+}
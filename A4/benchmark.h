@@ -0,0 +1,13 @@
+/* ----------------------------------------------------------------------------
+ * @file BENCHMARK.H
+ * @author Si Xun Li - 260674916
+ * @version 1.0
+ * @brief This file is the header file for the benchmarks.
+ * ----------------------------------------------------------------------------
+ */
+
+/*
+ * Available functions for the benchmarks
+ */
+int bench_cmd(char **parsed_words, int num_of_words, void *pcb, int is_cpu);
+double now_seconds();
@@ -0,0 +1,176 @@
+/* ----------------------------------------------------------------------------
+ * @file COMMAND.C
+ * @author Si Xun Li - 260674916
+ * @version 1.0
+ * @brief This file contains the command registry. Commands are looked up by
+ *        name in an open-addressing hash table, so the cost of resolving a
+ *        command does not grow with the number of commands. The registry
+ *        also enforces the number of words and whether a command may only be
+ *        executed from an exec script.
+ * ----------------------------------------------------------------------------
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "constant.h"
+#include "command.h"
+
+/*
+ * Registered command
+ */
+typedef struct command command_t;
+struct command {
+	const char *name;
+	command_handler_t handler;
+	int min_words;
+	int max_words;
+	int cpu_only;
+	int error_code;
+	const char *usage;
+};
+
+command_t commands[MAX_COMMANDS];
+int command_count = 0;
+
+/*
+ * Lookup table holding opcode + 1, so that 0 marks an empty slot
+ */
+int command_table[COMMAND_TABLE_SIZE];
+
+/*
+ * Private function
+ */
+unsigned int hash_command(const char *name);
+
+/* ----------------------------------------------------------------------------
+ * @brief Hashes the name of a command using FNV-1a.
+ * @param input  - name - The name of a command
+ * @return The first slot to probe in the lookup table
+ * ----------------------------------------------------------------------------
+ */
+unsigned int hash_command(const char *name) {
+	unsigned int hash = 2166136261u;
+	while (*name) {
+		hash ^= (unsigned char) *name++;
+		hash *= 16777619u;
+	}
+	return hash & (COMMAND_TABLE_SIZE - 1);
+}
+
+/* ----------------------------------------------------------------------------
+ * @brief Registers a command.
+ * @param input  - name       - The name of the command. Must outlive the
+ *                              registry
+ *        input  - handler    - The function handling the command
+ *        input  - min_words  - Minimum number of words, including the name
+ *        input  - max_words  - Maximum number of words, including the name,
+ *                              or ANY_NUMBER_OF_WORDS
+ *        input  - cpu_only   - Can the command only come from the CPU
+ *        input  - error_code - Status code returned when a constraint fails
+ *        input  - usage      - Printed when the number of words is invalid
+ * @return int - The opcode of the command or status code
+ *                 -1 - Name or handler is null
+ *                 -2 - The command is already registered
+ *                 -3 - The registry is full
+ * ----------------------------------------------------------------------------
+ */
+int register_command(const char *name,
+                     command_handler_t handler,
+                     int min_words,
+                     int max_words,
+                     int cpu_only,
+                     int error_code,
+                     const char *usage) {
+	unsigned int slot;
+	command_t *command;
+
+	if (!name || !handler) {
+		return -1;
+	}
+
+	if (find_command(name) != COMMAND_UNKNOWN) {
+		return -2;
+	}
+
+	if (command_count >= MAX_COMMANDS) {
+		return -3;
+	}
+
+	command = &commands[command_count];
+	command->name = name;
+	command->handler = handler;
+	command->min_words = min_words;
+	command->max_words = max_words;
+	command->cpu_only = cpu_only;
+	command->error_code = error_code;
+	command->usage = usage;
+
+	for (slot = hash_command(name); command_table[slot] != 0;
+	     slot = (slot + 1) & (COMMAND_TABLE_SIZE - 1));
+	command_table[slot] = command_count + 1;
+
+	return command_count++;
+}
+
+/* ----------------------------------------------------------------------------
+ * @brief Finds a command by name.
+ * @param input  - name - The name of a command
+ * @return The opcode of the command. COMMAND_UNKNOWN if it is not registered
+ * ----------------------------------------------------------------------------
+ */
+int find_command(const char *name) {
+	unsigned int slot;
+	int opcode;
+
+	if (!name) {
+		return COMMAND_UNKNOWN;
+	}
+
+	for (slot = hash_command(name); command_table[slot] != 0;
+	     slot = (slot + 1) & (COMMAND_TABLE_SIZE - 1)) {
+		opcode = command_table[slot] - 1;
+		if (strcmp(commands[opcode].name, name) == 0) {
+			return opcode;
+		}
+	}
+	return COMMAND_UNKNOWN;
+}
+
+/* ----------------------------------------------------------------------------
+ * @brief Checks the constraints of a command and calls its handler.
+ * @param input  - opcode       - The opcode returned by find_command
+ *        input  - parsed_words - An array of strings
+ *        input  - num_of_words - Number of elements in the array
+ *        input  - context      - Passed to the handler
+ *        input  - is_cpu       - Does the command come from the CPU
+ * @return int - The status code of the handler, the error code of the
+ *               command if a constraint failed or -1 if the opcode is unknown
+ * ----------------------------------------------------------------------------
+ */
+int dispatch_command(int opcode,
+                     char **parsed_words,
+                     int num_of_words,
+                     void *context,
+                     int is_cpu) {
+	command_t *command;
+
+	if (opcode < 0 || opcode >= command_count) {
+		return -1;
+	}
+	command = &commands[opcode];
+
+	if (num_of_words < command->min_words ||
+	    (command->max_words != ANY_NUMBER_OF_WORDS &&
+	     num_of_words > command->max_words)) {
+		printf(GENERIC_EXPECTED_MSG "%s\n", command->usage);
+		return command->error_code;
+	}
+
+	if (command->cpu_only && is_cpu == 0) {
+		printf(GENERIC_ERROR_MSG
+		       "this command can only be executed in an exec script\n");
+		return command->error_code;
+	}
+
+	return command->handler(parsed_words, num_of_words, context, is_cpu);
+}
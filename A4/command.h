@@ -0,0 +1,55 @@
+/* ----------------------------------------------------------------------------
+ * @file COMMAND.H
+ * @author Si Xun Li - 260674916
+ * @version 1.0
+ * @brief This file is the header file for the command registry. The registry
+ *        only depends on the generic messages of constant.h so that any of the
+ *        interpreters can register their own commands with it.
+ * ----------------------------------------------------------------------------
+ */
+
+/*
+ * Declare the maximum number of commands and the size of the lookup table.
+ * The table size must be a power of two larger than the number of commands.
+ */
+#define MAX_COMMANDS            32
+#define COMMAND_TABLE_SIZE      64
+
+/*
+ * Opcode of a command that is not registered
+ */
+#define COMMAND_UNKNOWN         -1
+
+/*
+ * Number of words accepted by a command taking any number of arguments
+ */
+#define ANY_NUMBER_OF_WORDS     -1
+
+/*
+ * A command handler receives the words of the command, including its name,
+ * the context of the caller and whether the command comes from the CPU.
+ */
+#ifndef COMMAND_H
+#define COMMAND_H
+typedef int (*command_handler_t)(char **parsed_words,
+                                 int num_of_words,
+                                 void *context,
+                                 int is_cpu);
+#endif
+
+/*
+ * Available functions for the command registry
+ */
+int register_command(const char *name,
+                     command_handler_t handler,
+                     int min_words,
+                     int max_words,
+                     int cpu_only,
+                     int error_code,
+                     const char *usage);
+int find_command(const char *name);
+int dispatch_command(int opcode,
+                     char **parsed_words,
+                     int num_of_words,
+                     void *context,
+                     int is_cpu);
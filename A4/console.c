@@ -0,0 +1,118 @@
+/* ----------------------------------------------------------------------------
+ * @file CONSOLE.C
+ * @author Si Xun Li - 260674916
+ * @version 1.0
+ * @brief This file controls how the kernel writes to the console. Echoing of
+ *        script lines can be turned off, and output can be batched in one
+ *        large buffer that is only flushed at quantum boundaries, on print
+ *        and before the shell reads input. Batching does not change the bytes
+ *        written, only when they are written.
+ * ----------------------------------------------------------------------------
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include "constant.h"
+#include "console.h"
+
+/*
+ * Output modes
+ */
+int echo_enabled = 1;
+int batched = 0;
+char batch_buffer[CONSOLE_BUFFER_SIZE];
+
+/* ----------------------------------------------------------------------------
+ * @brief Turns the echo of executed script lines on or off.
+ * @param input  - enabled - 1 to echo lines, 0 to suppress them
+ * ----------------------------------------------------------------------------
+ */
+void set_echo(int enabled) {
+	echo_enabled = enabled;
+}
+
+/* ----------------------------------------------------------------------------
+ * @brief Returns whether executed script lines are echoed.
+ * ----------------------------------------------------------------------------
+ */
+int is_echo_enabled() {
+	return echo_enabled;
+}
+
+/* ----------------------------------------------------------------------------
+ * @brief Switches stdout between batched and default buffering. The default
+ *        buffering of stdout is line buffering on a terminal and full
+ *        buffering otherwise.
+ * @param input  - enabled - 1 to batch output, 0 to restore default buffering
+ * @return int - Status code
+ *                  0 - No errors
+ *                 -1 - Buffering could not be changed
+ * ----------------------------------------------------------------------------
+ */
+int set_batched(int enabled) {
+	int err;
+
+	// Default buffering is left as it is
+	if (!enabled && !batched) {
+		return 0;
+	}
+
+	// Pending output must be written before the buffer is replaced
+	fflush(stdout);
+	if (enabled) {
+		err = setvbuf(stdout, batch_buffer, _IOFBF, CONSOLE_BUFFER_SIZE);
+	} else if (isatty(STDOUT_FILENO)) {
+		err = setvbuf(stdout, NULL, _IOLBF, BUFSIZ);
+	} else {
+		err = setvbuf(stdout, NULL, _IOFBF, BUFSIZ);
+	}
+
+	if (err != 0) {
+		return -1;
+	}
+	batched = enabled;
+	return 0;
+}
+
+/* ----------------------------------------------------------------------------
+ * @brief Writes batched output. Called at the points where output must be
+ *        visible. Does nothing when output is not batched.
+ * ----------------------------------------------------------------------------
+ */
+void flush_console() {
+	if (batched) {
+		fflush(stdout);
+	}
+}
+
+/* ----------------------------------------------------------------------------
+ * @brief Changes the output mode. Supports the following modes
+ *            - echo     - Echo executed script lines (default)
+ *            - quiet    - Do not echo executed script lines
+ *            - batched  - Buffer output until a quantum ends
+ *            - direct   - Write output as it is produced (default)
+ * @param input  - parsed_words - An array of strings
+ *        input  - num_of_words - Number of elements in the array
+ * @return int - Status code
+ *                  0 - No errors
+ *                 -7 - Unknown mode
+ * ----------------------------------------------------------------------------
+ */
+int output_cmd(char **parsed_words, int num_of_words, void *pcb, int is_cpu) {
+	char *mode = parsed_words[1];
+
+	if (strcmp(mode, "echo") == 0) {
+		set_echo(1);
+	} else if (strcmp(mode, "quiet") == 0) {
+		set_echo(0);
+	} else if (strcmp(mode, "batched") == 0) {
+		set_batched(1);
+	} else if (strcmp(mode, "direct") == 0) {
+		set_batched(0);
+	} else {
+		printf(GENERIC_EXPECTED_MSG "output <echo|quiet|batched|direct>\n");
+		return -7;
+	}
+	return 0;
+}
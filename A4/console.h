@@ -0,0 +1,16 @@
+/* ----------------------------------------------------------------------------
+ * @file CONSOLE.H
+ * @author Si Xun Li - 260674916
+ * @version 1.0
+ * @brief This file is the header file for the console output modes.
+ * ----------------------------------------------------------------------------
+ */
+
+/*
+ * Available functions for the console
+ */
+void set_echo(int enabled);
+int is_echo_enabled();
+int set_batched(int enabled);
+void flush_console();
+int output_cmd(char **parsed_words, int num_of_words, void *pcb, int is_cpu);
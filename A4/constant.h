@@ -20,6 +20,11 @@
  */
 #define MAX_LINE_LENGTH         1024
 
+/*
+ * Declare maximum number of words in a line
+ */
+#define MAX_WORDS               (MAX_CMD_LENGTH / 2)
+
 /*
  * Declare maximum number of concurrent files that can be opened per exec
  */
@@ -31,24 +36,229 @@
 #define MAX_FILENAME_LENGTH     1024
 
 /*
- * Declare the size of RAM
+ * Declare the prefix of an exec argument naming a manifest, a file listing
+ * one script per line
+ */
+#define MANIFEST_PREFIX         '@'
+
+/*
+ * Declare the number of file descriptors kept for stdin, stdout and stderr,
+ * the partitions and the I/O worker, and the descriptors kept per CPU for
+ * the files opened while a script is launched
+ */
+#define RESERVED_DESCRIPTORS    (3 + 5 + 1)
+#define CPU_DESCRIPTORS         1
+
+/*
+ * Declare the maximum length of a line of the boot configuration file
+ */
+#define MAX_CONFIG_LINE_LENGTH  256
+
+/*
+ * Declare the default size of RAM in frames and its maximum. Both can be set
+ * when the kernel boots.
+ */
+#define DEFAULT_RAM_SIZE        10
+#define MAX_RAM_SIZE            (1 << 20)
+
+/*
+ * Declare the default size of a page in lines and its maximum
+ */
+#define DEFAULT_PAGE_SIZE       4
+#define MAX_PAGE_SIZE           (1 << 16)
+
+/*
+ * Declare the default number of frames loaded when a process is created
+ */
+#define DEFAULT_INITIAL_FRAMES  2
+
+/*
+ * Declare the number of buckets of the table finding frames by the content of
+ * their page per frame of RAM. Must be a power of two.
+ */
+#define FRAME_BUCKETS_PER_FRAME 2
+
+/*
+ * Declare the free lists of the frames. Frames that never held a page or
+ * were overwritten are taken before those keeping the page of a finished
+ * process, which another process may still share.
+ */
+#define FRAME_NOT_FREE          -1
+#define FRAME_EMPTY             0
+#define FRAME_KEPT              1
+#define FRAME_FREE_LISTS        2
+
+/*
+ * Declare the default number of pages loaded by a page fault, the faulting
+ * page included, and the maximum. Pages after the faulting one are only
+ * loaded into empty frames.
+ */
+#define DEFAULT_FAULT_AROUND    1
+#define MAX_FAULT_AROUND        64
+
+/*
+ * Declare the default percentage of a page a process executes before its
+ * next page is read ahead. 0 disables read-ahead.
+ */
+#define DEFAULT_READ_AHEAD      0
+
+/*
+ * Declare the number of references to frames after which a page unused since
+ * leaves the working set of its process
+ */
+#define WORKING_SET_WINDOW      32
+
+/*
+ * Declare the default quanta size
+ */
+#define DEFAULT_QUANTA          2
+
+/*
+ * Declare the defaults of the scheduling policies: the levels of the
+ * multi-level feedback queue, the number of dispatches between two boosts of
+ * every process to its top level and the tickets of a lottery process
+ */
+#define MAX_POLICY_ARGS         3
+#define MLFQ_LEVELS             3
+#define MLFQ_MAX_LEVELS         8
+#define MLFQ_BOOST_INTERVAL     64
+#define LOTTERY_TICKETS         100
+
+/*
+ * Declare the bounds of lottery scheduling: the largest quantum and number of
+ * tickets it may be configured with and the most tickets a process may hold
+ * after being compensated for a short quantum
+ */
+#define LOTTERY_MAX_QUANTUM     (1 << 16)
+#define LOTTERY_MAX_TICKETS     (1 << 20)
+#define LOTTERY_MAX_HELD        (1 << 24)
+
+/*
+ * Declare the maximum number of simulated CPUs
+ */
+#define MAX_CPUS                64
+
+/*
+ * Declare the initial capacity of the shell memory hash table. Must be a power
+ * of two.
+ */
+#define HASH_INITIAL_CAPACITY   64
+
+/*
+ * Declare the maximum load factor of the shell memory hash table as a fraction
+ */
+#define HASH_LOAD_FACTOR_NUM    7
+#define HASH_LOAD_FACTOR_DEN    10
+
+/*
+ * Declare the smallest size class of the shell memory arena, the number of
+ * power-of-two classes above it and the size of the chunks blocks are carved
+ * from
+ */
+#define ARENA_MIN_CLASS         16
+#define ARENA_CLASS_COUNT       8
+#define ARENA_CHUNK_SIZE        65536
+
+/*
+ * Declare the number of slots of the ready queue. Must be a power of two.
+ */
+#define READY_QUEUE_CAPACITY    4096
+
+/*
+ * Declare the initial number of slots of the run queue of a CPU
+ */
+#define CPU_QUEUE_INITIAL_CAPACITY  16
+
+/*
+ * Declare the size of a cache line, used to keep data written by different
+ * CPUs apart
+ */
+#define CACHE_LINE_SIZE         64
+
+/*
+ * Declare the states of a process
+ */
+#define PCB_READY               0
+#define PCB_RUNNING             1
+#define PCB_BLOCKED             2
+
+/*
+ * Declare the number of PCBs the PCB pool grows by
+ */
+#define PCB_POOL_CHUNK          64
+
+/*
+ * Declare the number of buckets of the compiled program cache
+ */
+#define PROGRAM_CACHE_BUCKETS   1024
+
+/*
+ * Declare the largest script that can be compiled, in bytes
+ */
+#define MAX_PROGRAM_TEXT_SIZE   (1 << 30)
+
+/*
+ * Declare the initial value of the hash of the content of a script
+ */
+#define CONTENT_HASH_SEED       14695981039346656037ull
+
+/*
+ * Declare the magic number and the version of the index of a compiled
+ * program. The version must change with the format of the index or with the
+ * rules compiling a line.
+ */
+#define PROGRAM_INDEX_MAGIC     0x58444950
+#define PROGRAM_INDEX_VERSION   1
+
+/*
+ * Declare the size of the buffer used when console output is batched
+ */
+#define CONSOLE_BUFFER_SIZE     (1 << 20)
+
+/*
+ * Declare the parameters of the workload benchmark: the folder receiving the
+ * generated scripts, the partition they mount and the number of distinct
+ * variables and files they use
+ */
+#define BENCH_MAX_ARGS              6
+#define BENCH_FOLDER_NAME           "Benchmark"
+#define BENCH_PARTITION             "bench"
+#define BENCH_PARTITION_BLOCKS      40
+#define BENCH_PARTITION_BLOCK_SIZE  16
+#define BENCH_VARIABLES             16
+#define BENCH_FILES                 4
+
+/*
+ * Declare how long each run of the scheduling benchmark lasts
+ */
+#define BENCH_SCHED_NANOSECONDS     100000000
+
+/*
+ * Declare the number of processes the context switch benchmark cycles
+ * through and the number of pages of the script it loads pages from
  */
-#define RAM_SIZE                10
+#define BENCH_SWITCH_PROCESSES      64
+#define BENCH_SWITCH_PAGES          16
 
 /*
- * Declare the size of a page
+ * Declare the name of the backing store folder
  */
-#define PAGE_SIZE               4
+#define BACKING_STORE_NAME      "BackingStore"
 
 /*
- * Declare initial frame count
+ * Declare the default number of kilobytes the backing store may keep across
+ * boots and the part of it kept when the least recently used entries are
+ * collected as a fraction
  */
-#define INITIAL_FRAME_NUMBER    2
+#define DEFAULT_BACKING_STORE_LIMIT 65536
+#define BACKING_STORE_KEEP_NUM      3
+#define BACKING_STORE_KEEP_DEN      4
 
 /*
- * Declare quanta size
+ * Declare the size of the buffer used when a file cannot be copied by the
+ * kernel
  */
-#define QUANTA                  2
+#define COPY_BUFFER_SIZE        65536
 
 /*
  * Declare the name of the partion folder
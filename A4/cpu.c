@@ -7,157 +7,279 @@
  */
 #include <stdio.h>
 #include <stdlib.h>
-#include <unistd.h>
 #include "cpu.h"
 #include "kernel.h"
 #include "interpreter.h"
 #include "constant.h"
 #include "memorymanager.h"
+#include "replacement.h"
+#include "benchmark.h"
 
 /*
- * Local function
- */
-int page_fault();
-
-/*
- * CPU structure
+ * CPU structure. The instruction pointer is the frame holding the executing
+ * page and the offset of the line within it, so a context switch only copies
+ * a few words. The instruction register is the CPU's line buffer: the words
+ * of the executing instruction are built in it so that executing a line does
+ * not allocate. The PCB of the executing process is stored with the CPU. The
+ * busy time is the time spent running processes.
  */
 typedef struct cpu cpu_t;
 struct cpu {
-	FILE *IP;
+	int IP;
 	char IR[MAX_CMD_LENGTH];
 	int quanta;
 	int offset;
+	pcb_t *pcb_storage;
+	double busy_time;
 };
 
-cpu_t *cpu;
+/*
+ * Local function
+ */
+int map_page(pcb_t *pcb);
+int page_fault(cpu_t *cpu);
 
-// Temporarily stores the PCB while the process is being executed
-pcb_t *pcb_storage;
+// Each simulated CPU is driven by its own thread
+cpu_t *cpus;
+int cpu_count = 0;
 
 /* ----------------------------------------------------------------------------
- * @brief Initializes the local CPU structure. This code should be called only
- *        a single time.
+ * @brief Initializes the CPU structures. This code should be called only a
+ *        single time.
+ * @param input  - count - Number of CPUs, between 1 and MAX_CPUS
+ * @return int - Status code
+ *                  0 - No errors
+ *                 -1 - Invalid number of CPUs
+ *                 -2 - Memory could not be allocated
  * ----------------------------------------------------------------------------
  */
-void init_cpu() {
-	if (!cpu) {
-		cpu = (cpu_t *) malloc(sizeof(cpu_t));
+int init_cpu(int count) {
+	if (count < 1 || count > MAX_CPUS) {
+		return -1;
 	}
-	if (!pcb_storage) {
-		pcb_storage = (pcb_t *) malloc(sizeof(pcb_t));
+	if (!cpus) {
+		cpus = (cpu_t *) calloc(count, sizeof(cpu_t));
+		if (!cpus) {
+			return -2;
+		}
+		cpu_count = count;
 	}
+	return 0;
+}
+
+/* ----------------------------------------------------------------------------
+ * @brief Returns the number of simulated CPUs.
+ * ----------------------------------------------------------------------------
+ */
+int get_cpu_count() {
+	return cpu_count;
 }
 
 /* ----------------------------------------------------------------------------
- * @brief Loads the content of a PCB into the CPU and temporarily stores the
+ * @brief Returns the time every CPU spent running processes. Only exact when
+ *        the scheduler is not running.
+ * @return The busy time in seconds
+ * ----------------------------------------------------------------------------
+ */
+double get_cpu_busy_time() {
+	double busy_time = 0.0;
+	int i;
+
+	for (i = 0; i < cpu_count; i++) {
+		busy_time += cpus[i].busy_time;
+	}
+	return busy_time;
+}
+
+/* ----------------------------------------------------------------------------
+ * @brief Loads the content of a PCB into a CPU and temporarily stores the
  *        PCB.
- * @param input  - pcb   A pointer to a PCB
+ * @param input  - cpu_id  The CPU to load
+ *        input  - pcb     A pointer to a PCB
+ *        input  - quanta  Lines the process may run
  * @return int - Status code
  *                  0 - No errors
  *                 -1 - PCB pointer is null
  * ----------------------------------------------------------------------------
  */
-int context_switch(pcb_t *pcb) {
+int context_switch(int cpu_id, pcb_t *pcb, int quanta) {
+	cpu_t *cpu = &cpus[cpu_id];
+
 	if (!pcb) {
 		return -1;
 	}
-	pcb_storage = pcb;
-	cpu->IP = pcb->pc;
+	cpu->pcb_storage = pcb;
+	__atomic_add_fetch(&counters.context_switches, 1, __ATOMIC_RELAXED);
+	pcb->counters.quanta++;
+	cpu->IP = pcb->pc_frame;
 	cpu->offset = pcb->pc_offset;
-	cpu->quanta = QUANTA;
+	cpu->quanta = quanta;
 	return 0;
 }
 
 /* ----------------------------------------------------------------------------
- * @brief Executes the file pointed loaded in the CPU.
+ * @brief Checks if a process has lines left to execute. A process blocked on
+ *        the last line of its script has none when its I/O completes.
+ * @param input  - pcb - The process
+ * @return 1 if a line is left, 0 otherwise
+ * ----------------------------------------------------------------------------
+ */
+int has_next_line(pcb_t *pcb) {
+	return pcb->pc_page <= pcb->pages_max &&
+	       (pcb->pc_page - 1) * get_page_size() + pcb->pc_offset <
+	       pcb->program->line_count;
+}
+
+/* ----------------------------------------------------------------------------
+ * @brief Executes the compiled instructions of the process loaded in a CPU.
+ *        The lines are read from the frame of the executing page, which is
+ *        pinned for the quantum. The kernel-wide line counter is shared by
+ *        every CPU so it is updated once per quantum. The quantum ends early
+ *        if a line blocks the process on I/O.
+ * @param input  - cpu_id  The CPU to run
  * @return int - Status code
  *                  0 - Ran out of quanta
+ *                  1 - Blocked on I/O
  *                 -1 - EOF
  * ----------------------------------------------------------------------------
  */
-int run() {
-	while(cpu->quanta > 0 && cpu->offset < PAGE_SIZE) {
+int run(int cpu_id) {
+	int line, executed, status, blocked;
+	int page_size = get_page_size();
+	cpu_t *cpu = &cpus[cpu_id];
+	pcb_t *pcb_storage = cpu->pcb_storage;
+	program_t *program = pcb_storage->program;
+	double start = now_seconds();
+	char *text;
+
+	// The page may have been taken by another process while this one waited
+	lock_frames();
+	cpu->IP = map_page(pcb_storage);
+	pin_frame(cpu->IP);
+	unlock_frames();
+	if (cpu->IP == -1) {
+		// Every frame is executing. The process runs on its next quantum
+		cpu->busy_time += now_seconds() - start;
+		return 0;
+	}
+
+	executed = 0;
+	status = 1;
+	blocked = 0;
+	while(cpu->quanta > 0 && cpu->offset < page_size) {
+		line = (pcb_storage->pc_page - 1) * page_size + cpu->offset;
+		text = get_frame_line(cpu->IP, cpu->offset);
 		cpu->quanta--;
 		cpu->offset++;
-		if (fgets(cpu->IR, MAX_CMD_LENGTH, cpu->IP)) {
-			run_line_from_script(cpu->IR, pcb_storage, 1);
+		if (line < program->line_count && text) {
+			run_instruction(program, line, text, pcb_storage, 1, cpu->IR);
+			executed++;
+			if (pcb_storage->state == PCB_BLOCKED) {
+				blocked = 1;
+				break;
+			}
 		} else {
 			// EOF
-			return -1;
+			status = -1;
+			break;
 		}
 	}
 
+	pcb_storage->counters.lines += executed;
+	__atomic_add_fetch(&counters.lines, executed, __ATOMIC_RELAXED);
+
 	// Checks for the reason for stopping the execution of the script
-	return page_fault();
+	if (status != -1) {
+		status = page_fault(cpu);
+	} else {
+		lock_frames();
+		unpin_frame(cpu->IP);
+		unlock_frames();
+	}
+	cpu->busy_time += now_seconds() - start;
+
+	// A blocked process that reached the end of its file finishes once its
+	// I/O completed, without running again
+	if (blocked) {
+		return 1;
+	}
+	return status;
+}
+
+/* ----------------------------------------------------------------------------
+ * @brief Finds the frame holding the page a process executes and sets its
+ *        reference bit. The page is loaded from disk if it is not in a frame.
+ *        The frames must be locked.
+ * @param input  - pcb - The process
+ * @return The number of the frame. -1 if the page could not be loaded
+ * ----------------------------------------------------------------------------
+ */
+int map_page(pcb_t *pcb) {
+	int frame_number;
+
+	// The frame of the page is kept unless the page was evicted
+	if (pcb->pc_frame >= 0 && find_frame(pcb, pcb->pc_page) == pcb->pc_frame) {
+		reference_frame(pcb->pc_frame, 1);
+		return pcb->pc_frame;
+	}
+
+	// Checks if the frame is already loaded into memory, possibly ahead of
+	// the process
+	frame_number = find_frame(pcb, pcb->pc_page);
+	if (frame_number != -1) {
+		take_prefetched(frame_number);
+		reference_frame(frame_number, 1);
+		pcb->pc_frame = frame_number;
+		return frame_number;
+	}
+
+	// Load page from disk, with the pages following it if frames are empty
+	frame_number = load_page(pcb, pcb->pc_page, 1);
+	if (frame_number == -1) {
+		return -1;
+	}
+	counters.page_faults++;
+	pcb->counters.page_faults++;
+	fault_around(pcb, pcb->pc_page);
+
+	pcb->pc_frame = frame_number;
+	reference_frame(frame_number, 0);
+	return frame_number;
 }
 
 /* ----------------------------------------------------------------------------
- * @brief Checks if the process ran out of quanta or ran into a page fault. If
- *        it's the latter, first check if the
+ * @brief Checks if the process ran out of quanta, blocked or ran into a page
+ *        fault. If it's the latter, the next page is loaded unless it is
+ *        already in a frame. The frames are shared by every CPU and are
+ *        locked while the executed frame is unpinned and while frames are
+ *        inspected and replaced.
+ * @param input  - cpu - The CPU that stopped executing
  * @return -1 if EOF was reached, 0 otherwise.
  * ----------------------------------------------------------------------------
  */
-int page_fault() {
-	int i, stored_in_frame, frame_number, victim_number;
-	fpos_t pos;
-	FILE *file;
+int page_fault(cpu_t *cpu) {
+	pcb_t *pcb_storage = cpu->pcb_storage;
+	int status = 0;
 
-	if (cpu->quanta == 0 && cpu->offset < PAGE_SIZE) {
-		// Ran out of quanta
+	lock_frames();
+	unpin_frame(cpu->IP);
+
+	if (cpu->offset < get_page_size()) {
+		// Ran out of quanta or blocked in the middle of the page. The next
+		// page is read ahead once enough of the page was executed
 		pcb_storage->pc_offset = cpu->offset;
+		read_ahead(pcb_storage, cpu->offset);
+	} else if (pcb_storage->pc_page + 1 > pcb_storage->pages_max) {
+		pcb_storage->pc_page++;
+		status = -1;
 	} else {
-		// Page replacement is needed
+		// Page replacement is needed. If every frame is executing the page
+		// is loaded when the process runs again
 		pcb_storage->pc_page++;
-		
-		if (pcb_storage->pc_page > pcb_storage->pages_max) {
-			return -1;
-		}
-
 		pcb_storage->pc_offset = 0;
-		stored_in_frame = 0;
-
-		// Checks if the frame is already loaded into memory
-		for (i = 0; i < RAM_SIZE; i++) {
-			if (pcb_storage->page_table[i] == pcb_storage->pc_page) {
-				stored_in_frame = 1;
-				break;
-			}
-		}
-
-		// Load page from disk
-		if (stored_in_frame == 0) {
-			// First make a copy of the position in the file stream
-			fgetpos(cpu->IP, &pos);
-
-			// Duplicate file pointer and find page
-			file = fdopen(dup(fileno(cpu->IP)), "r");
-			file = find_page(pcb_storage->pc_page, file);
-
-			// Attempt to find an empty frame and a victim frame
-			frame_number = find_empty_frame();
-
-			if (frame_number == -1) {
-				// Select a victim and overwrite its frame
-				victim_number = find_victim(pcb_storage);
-
-				// Overwrites the frame with new content
-				update_frame(frame_number, victim_number, file);
-
-				// Update page table for both victim and current pcb
-				update_victim_page_table(frame_number, victim_number);
-				update_page_table(pcb_storage, pcb_storage->pc_page,
-			                    frame_number, victim_number);
-			} else {
-				// No victim needed
-				update_frame(frame_number, -1, file);
-				update_page_table(pcb_storage, pcb_storage->pc_page,
-				                  frame_number, -1);
-			}
-			// Set the position back
-			fsetpos(cpu->IP, &pos);
-		}
+		map_page(pcb_storage);
 	}
 
-	return 0;
+	unlock_frames();
+	return status;
 }
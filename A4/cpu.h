@@ -11,6 +11,9 @@
 /*
  * Public functions
  */
-void init_cpu();
-int context_switch(pcb_t *pcb);
-int run();
+int init_cpu(int count);
+int get_cpu_count();
+double get_cpu_busy_time();
+int context_switch(int cpu_id, pcb_t *pcb, int quanta);
+int run(int cpu_id);
+int has_next_line(pcb_t *pcb);
@@ -9,10 +9,13 @@
 #include <stdio.h>
 #include <string.h>
 #include <dirent.h>
+#include <sys/stat.h>
 #include <stdlib.h>
+#include <pthread.h>
 #include "interpreter.h"
 #include "constant.h"
 #include "disk_driver.h"
+#include "kernel.h"
 
 /*
  * Data structures used by this file
@@ -43,6 +46,12 @@ struct FAT_FP_MAP {
 	int fat;
 } fat_fp_map[5];
 
+/*
+ * Guards the partition, the FAT, the block buffer and the I/O scheduler's wait
+ * queue against concurrent CPUs
+ */
+pthread_mutex_t disk_lock = PTHREAD_MUTEX_INITIALIZER;
+
 int find_empty_fp();
 void clean_block(int file);
 int find_empty_block(int file);
@@ -97,7 +106,7 @@ int partition_drive(char *name, int total_blocks, int block_size) {
 	if (dir) {
 		closedir(dir);
 	} else {
-		system("mkdir PARTITION");
+		mkdir(PARTITION_FOLDER_NAME, 0755);
 	}
 
 	// Checks if inputs are valid
@@ -253,7 +262,7 @@ int mount(char *name) {
 	partition.partition_name = malloc(MAX_CMD_LENGTH);
 	strcpy(partition.partition_name, relative_path);
 
-	while (lines_read <= expected) {
+	while (lines_read < expected) {
 		if (fgets(line, MAX_CMD_LENGTH, file)) {
 			line[strlen(line) - 1] = '\0';
 			if (lines_read == 0) {
@@ -499,6 +508,7 @@ int read_block(int file) {
 	fp[track_fp] = NULL;
 
 	fat[file].current_location++;
+	counters.blocks_read++;
 	return 1;
 }
 
@@ -600,6 +610,7 @@ int write_block(int file, char *data) {
 	fclose(fp[track_fp]);
 	fp[track_fp] = NULL;
 
+	counters.blocks_written++;
 	return 1;
 }
 
@@ -782,3 +793,20 @@ void debug_disk_driver() {
 		       i, fat_fp_map[i].fat, fp[i]);
 	}
 }
+
+/* ----------------------------------------------------------------------------
+ * @brief Acquires the disk. Must be held from the moment a file is opened
+ *        until the blocks returned by the I/O scheduler were consumed.
+ * ----------------------------------------------------------------------------
+ */
+void lock_disk() {
+	pthread_mutex_lock(&disk_lock);
+}
+
+/* ----------------------------------------------------------------------------
+ * @brief Releases the disk.
+ * ----------------------------------------------------------------------------
+ */
+void unlock_disk() {
+	pthread_mutex_unlock(&disk_lock);
+}
@@ -15,3 +15,5 @@ char *return_block();
 int write_block(int file, char *data);
 int get_block_size();
 void debug_disk_driver();
+void lock_disk();
+void unlock_disk();
@@ -12,6 +12,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <ctype.h>
+#include <unistd.h>
 #include "shell.h"
 #include "ram.h"
 #include "kernel.h"
@@ -19,20 +20,68 @@
 #include "interpreter.h"
 #include "io_scheduler.h"
 #include "memorymanager.h"
+#include "benchmark.h"
+#include "command.h"
+#include "console.h"
 
 /*
- * Local functions
+ * Local functions. Command handlers receive the executing PCB as context.
  */
 void print_debug(char **parsed_words, int num_of_words);
 void print_help();
-int print_var(char **parsed_words, int num_of_words);
-int run_file(char **parsed_words, int num_of_words);
-int set_var(char **parsed_words, int num_of_words);
+int quit_cmd(char **parsed_words, int num_of_words, void *pcb, int is_cpu);
+int help_cmd(char **parsed_words, int num_of_words, void *pcb, int is_cpu);
+int print_var(char **parsed_words, int num_of_words, void *pcb, int is_cpu);
+int run_file(char **parsed_words, int num_of_words, void *pcb, int is_cpu);
+int set_var(char **parsed_words, int num_of_words, void *pcb, int is_cpu);
 int read_and_exec_file(char *file);
-int exec(char **parsed_words, int num_of_words, int is_cpu);
-int mount_cmd(char **parsed_words, int num_of_words, int is_cpu);
-int write_cmd(char **parsed_words, int num_of_words, pcb_t *pcb, int is_cpu);
-int read_cmd(char **parsed_words, int num_of_words, pcb_t *pcb, int is_cpu);
+int exec(char **parsed_words, int num_of_words, void *pcb, int is_cpu);
+int mount_cmd(char **parsed_words, int num_of_words, void *pcb, int is_cpu);
+int write_cmd(char **parsed_words, int num_of_words, void *pcb, int is_cpu);
+int read_cmd(char **parsed_words, int num_of_words, void *pcb, int is_cpu);
+int mount_partition(char **parsed_words, int num_of_words, pcb_t *pcb);
+int write_file(char **parsed_words, int num_of_words, pcb_t *pcb);
+int read_file(char **parsed_words, int num_of_words, pcb_t *pcb);
+int exec_script(char *filename);
+int exec_manifest(char *manifest);
+int memstats_cmd(char **parsed_words, int num_of_words, void *pcb, int is_cpu);
+
+/* ----------------------------------------------------------------------------
+ * @brief Registers the supported commands. Must be called before any command
+ *        is interpreted or any script is compiled.
+ * ----------------------------------------------------------------------------
+ */
+void init_interpreter() {
+	register_command("quit", quit_cmd, 1, ANY_NUMBER_OF_WORDS, 0, -3,
+	                 "quit");
+	register_command("help", help_cmd, 1, ANY_NUMBER_OF_WORDS, 0, 0,
+	                 "help");
+	register_command("print", print_var, 2, 2, 0, -7,
+	                 "print <varname>");
+	register_command("run", run_file, 2, 2, 0, -7,
+	                 "run <filename>");
+	register_command("set", set_var, 3, ANY_NUMBER_OF_WORDS, 0, -7,
+	                 "set <varname> <value>");
+	register_command("exec", exec, 2, ANY_NUMBER_OF_WORDS, 0, -7,
+	                 "exec <script|@manifest>...");
+	register_command("mount", mount_cmd, 4, 4, 1, -9,
+	                 "mount <partition_name> <number_of_blocks> "
+	                 "<block_size>");
+	register_command("write", write_cmd, 3, ANY_NUMBER_OF_WORDS, 1, -10,
+	                 "write <filename> <words>");
+	register_command("read", read_cmd, 3, 3, 1, -11,
+	                 "read <filename> <variable_name>");
+	register_command("memstats", memstats_cmd, 1, ANY_NUMBER_OF_WORDS, 0, 0,
+	                 "memstats");
+	register_command("stats", stats_cmd, 1, ANY_NUMBER_OF_WORDS, 0, 0,
+	                 "stats");
+	register_command("sched", sched_cmd, 1, ANY_NUMBER_OF_WORDS, 0, -7,
+	                 "sched [<rr|mlfq|sjf|lottery> [<n>...]]");
+	register_command("bench", bench_cmd, 2, ANY_NUMBER_OF_WORDS, 0, -7,
+	                 "bench <benchmark> [<n>...]");
+	register_command("output", output_cmd, 2, 2, 0, -7,
+	                 "output <echo|quiet|batched|direct>");
+}
 
 /* ----------------------------------------------------------------------------
  * @brief Interprets an array of strings and calls the appropriate function
@@ -46,6 +95,11 @@ int read_cmd(char **parsed_words, int num_of_words, pcb_t *pcb, int is_cpu);
  *            - mount
  *            - write
  *            - read
+ *            - memstats
+ *            - stats
+ *            - sched
+ *            - bench
+ *            - output
  * @param input  - parsed_words - An array of strings
  *        input  - num_of_words - An integer representing the number of strings
  *        input  - pcb          - A PCB
@@ -69,101 +123,89 @@ int interpret(char **parsed_words,
               int num_of_words,
 							pcb_t *pcb,
               int is_cpu) {
-	int err, i;
 	// Catch if input is null
 	if (!parsed_words) {
-		err = -1;
-		return err;
+		return -1;
 	}
 
 	// Check if there are words
 	if (num_of_words < 1) {
-		err = -2;
-		return err;
-	}
-
-	// Handle user inputs
-	if (strcmp(parsed_words[0], "quit") == 0) {
-		/* ------------------------------------------------------------
-		 * Handles quit command
-		 * ------------------------------------------------------------
-		 */
-		err = -3;
-		clear_ram();
-		for (i = 0; i < RAM_SIZE; i++) {
-			if (ram[i] != NULL) {
-				fclose(ram[i]);
-				ram[i] = NULL;
-			}
-		}
-		system("rm -rf BackingStore");
-		return err;
-	} else if (strcmp(parsed_words[0], "help") == 0) {
-		/* ------------------------------------------------------------
-		 * Handles help command
-		 * ------------------------------------------------------------
-		 */
-		print_help();
-		err = 0;
-		return err;
-	} else if (strcmp(parsed_words[0], "print") == 0) {
-		/* ------------------------------------------------------------
-		 * Handles print command
-		 * ------------------------------------------------------------
-		 */
-		err = print_var(parsed_words, num_of_words);
-		return err;
-	} else if (strcmp(parsed_words[0], "run") == 0) {
-		/* ------------------------------------------------------------
-		 * Handles run command
-		 * ------------------------------------------------------------
-		 */
-		err = run_file(parsed_words, num_of_words);
-		return err;
-	} else if (strcmp(parsed_words[0], "set") == 0) {
-		/* ------------------------------------------------------------
-		 * Handles set command
-		 * ------------------------------------------------------------
-		 */
-		err = set_var(parsed_words, num_of_words);
-		return err;
-	} else if (strcmp(parsed_words[0], "exec") == 0) {
-		/* ------------------------------------------------------------
-		 * Handles exec command
-		 * ------------------------------------------------------------
-		 */
-		err = exec(parsed_words, num_of_words, is_cpu);
-		return err;
-	} else if (strcmp(parsed_words[0], "mount") == 0) {
-		/* ------------------------------------------------------------
-		 * Handles mount command
-		 * ------------------------------------------------------------
-		 */
-		err = mount_cmd(parsed_words, num_of_words, is_cpu);
-		return err;
-	} else if (strcmp(parsed_words[0], "write") == 0) {
-		/* ------------------------------------------------------------
-		 * Handles write command
-		 * ------------------------------------------------------------
-		 */
-		err = write_cmd(parsed_words, num_of_words, pcb, is_cpu);
-		return err;
-	} else if (strcmp(parsed_words[0], "read") == 0) {
-		/* ------------------------------------------------------------
-		 * Handles read command
-		 * ------------------------------------------------------------
-		 */
-		err = read_cmd(parsed_words, num_of_words, pcb, is_cpu);
-		return err;
-	} else {
-		/* ------------------------------------------------------------
-		 * Handles unknown inputs
-		 * ------------------------------------------------------------
-		 */
+		return -2;
+	}
+
+	return execute_command(find_command(parsed_words[0]),
+	                       parsed_words, num_of_words, pcb, is_cpu);
+}
+
+/* ----------------------------------------------------------------------------
+ * @brief Calls the handler of a resolved command through the registry. See
+ *        interpret for the status codes.
+ * @param input  - opcode       - The command, as returned by find_command
+ *        input  - parsed_words - An array of strings
+ *        input  - num_of_words - An integer representing the number of strings
+ *        input  - pcb          - A PCB
+ *        input  - is_cpu       - Does the input come from the CPU
+ * @return int - Status code
+ * ----------------------------------------------------------------------------
+ */
+int execute_command(int opcode,
+                    char **parsed_words,
+                    int num_of_words,
+                    pcb_t *pcb,
+                    int is_cpu) {
+	// Catch if input is null
+	if (!parsed_words) {
+		return -1;
+	}
+
+	// Check if there are words
+	if (num_of_words < 1) {
+		return -2;
+	}
+
+	// Handles unknown inputs
+	if (opcode == COMMAND_UNKNOWN) {
 		printf("Undefined command\n");
-		err = -7;
-		return err;
+		return -7;
 	}
+
+	return dispatch_command(opcode, parsed_words, num_of_words, pcb, is_cpu);
+}
+
+/* ----------------------------------------------------------------------------
+ * @brief Exits the shell after releasing the RAM. The backing store is kept
+ *        for the next boot.
+ * @return int - Status code
+ *                 -3 - Exit
+ * ----------------------------------------------------------------------------
+ */
+int quit_cmd(char **parsed_words, int num_of_words, void *pcb, int is_cpu) {
+	clear_ram();
+	return -3;
+}
+
+/* ----------------------------------------------------------------------------
+ * @brief Prints out available commands.
+ * @return int - Status code
+ *                  0 - No errors
+ * ----------------------------------------------------------------------------
+ */
+int help_cmd(char **parsed_words, int num_of_words, void *pcb, int is_cpu) {
+	print_help();
+	return 0;
+}
+
+/* ----------------------------------------------------------------------------
+ * @brief Prints out the footprint of the shell memory.
+ * @return int - Status code
+ *                  0 - No errors
+ * ----------------------------------------------------------------------------
+ */
+int memstats_cmd(char **parsed_words, int num_of_words, void *pcb, int is_cpu) {
+	lock_shell_memory();
+	print_memory_stats();
+	unlock_shell_memory();
+	return 0;
 }
 
 /* ----------------------------------------------------------------------------
@@ -197,7 +239,9 @@ void print_help () {
 	       TAB "set <varname> <value>    - Sets a variable to a value.\n"
 	       TAB "print <varname>          - Prints the value of a set variable.\n"
 	       TAB "run <script_name>        - Execute a script.\n"
-	       TAB "exec <s1> [<s2>] [<s3>]  - Execute scripts in parallel.\n"
+	       TAB "exec <s1> [<s2>...]      - Execute scripts in parallel. An\n"
+	       TAB "                           argument @<file> names a file\n"
+	       TAB "                           listing one script per line.\n"
 	       TAB "mount <partition_name> <number_of_blocks> <block_size> - Mounts\n"
 	       TAB "                           a partition. Unmounts previous\n"
 	       TAB "                           partition if applicable.\n"
@@ -208,7 +252,28 @@ void print_help () {
 	       TAB "read <filename> <variable_name> - Reads the content of a \n"
 	       TAB "                           file and stores it to a variable.\n"
 	       TAB "                           Can only be run in exec scripts\n"
-	       TAB "                           only.\n",
+	       TAB "                           only.\n"
+	       TAB "memstats                 - Displays the footprint of the\n"
+	       TAB "                           shell memory.\n"
+	       TAB "stats                    - Displays the counters of each\n"
+	       TAB "                           process.\n"
+	       TAB "sched [<policy> [<n>...]] - Displays or selects the\n"
+	       TAB "                           scheduling policy:\n"
+	       TAB "                           rr [<quantum>]\n"
+	       TAB "                           mlfq [<quantum>] [<levels>]\n"
+	       TAB "                           [<boost_interval>]\n"
+	       TAB "                           sjf [<quantum>]\n"
+	       TAB "                           lottery [<quantum>] [<tickets>]\n"
+	       TAB "bench <benchmark> [<n>...] - Runs a benchmark:\n"
+	       TAB "                           tokenizer [<lines>]\n"
+	       TAB "                           workload <processes> <lines>\n"
+	       TAB "                           [<set> <print> <read> <write>]\n"
+	       TAB "                           queue [<max_threads>] [<ops>]\n"
+	       TAB "                           sched [<max_cpus>] [<processes>]\n"
+	       TAB "                           switch [<switches>]\n"
+	       TAB "output <mode>            - Echo script lines (echo) or not\n"
+	       TAB "                           (quiet). Write output at once\n"
+	       TAB "                           (direct) or per quantum (batched).\n",
 	       SHELL_NAME,
 	       SHELL_VERSION);
 }
@@ -223,25 +288,24 @@ void print_help () {
  *                 -7 - Number of arguments is not as expected
  * ----------------------------------------------------------------------------
  */
-int print_var (char **parsed_words, int num_of_words) {
+int print_var (char **parsed_words, int num_of_words, void *pcb, int is_cpu) {
 	int err;
 	char output_value[MAX_CMD_LENGTH];
 	char *key;
-	if (num_of_words != 2) {
-		printf(GENERIC_EXPECTED_MSG "print <varname>\n");
-		return -7;
-	}
 
 	key = parsed_words[1];
 
 	// Search for the key and fetch the value by key if found
+	lock_shell_memory();
 	err = get_value_by_key(key, output_value);
+	unlock_shell_memory();
 
 	if (err < 0) {
 		// Failed to find the variable or there are invalid arguments
 		return -4;
 	} else {
 		printf("%s\n", output_value);
+		flush_console();
 		return 0;
 	}
 }
@@ -256,13 +320,9 @@ int print_var (char **parsed_words, int num_of_words) {
  *                 -7 - Number of arguments is not as expected          
  * ----------------------------------------------------------------------------
  */
-int run_file (char **parsed_words, int num_of_words) {
+int run_file (char **parsed_words, int num_of_words, void *pcb, int is_cpu) {
 	int err;
 	char *filename;
-	if (num_of_words != 2) {
-		printf(GENERIC_EXPECTED_MSG "run <filename>\n");
-		return -7;
-	}
 
 	filename = parsed_words[1];
 	err = read_and_exec_file(filename);
@@ -285,19 +345,13 @@ int run_file (char **parsed_words, int num_of_words) {
  *                 -7 - Number of arguments is not as expected
  * ----------------------------------------------------------------------------
  */
-int set_var (char **parsed_words, int num_of_words) {
+int set_var (char **parsed_words, int num_of_words, void *pcb, int is_cpu) {
 	int i, err;
 	unsigned int j;
 	char key[MAX_CMD_LENGTH];
 	char value[MAX_CMD_LENGTH];
 	int count = 0;
 
-	// Checks if the right number of arguments is obtained
-	if (num_of_words < 3) {
-		printf(GENERIC_EXPECTED_MSG "set <varname> <value>\n"); 
-		return -7;
-	}
-
 	// Copy key into a dedicated buffer to avoid corruption
 	strncpy(key, parsed_words[1], MAX_CMD_LENGTH);
 
@@ -313,11 +367,13 @@ int set_var (char **parsed_words, int num_of_words) {
 	value[count] = '\0';
 
 	// Attempt to insert the node
+	lock_shell_memory();
 	err = insert(0, key, value);
 	if (err == -1) {
 		// Key was found so update value
 		err = update_value_by_key(key, value);
 	}
+	unlock_shell_memory();
 
 	// Variable was not set properly
 	if (err != 0) {
@@ -329,7 +385,8 @@ int set_var (char **parsed_words, int num_of_words) {
 }
 
 /* ----------------------------------------------------------------------------
- * @brief Reads the content of a file and executes every line.
+ * @brief Executes every line of a script. The script is compiled on its first
+ *        run and reused until it is modified.
  * @param input  - filename   A filename
  * @return int - Status code
  *                  0 - No errors
@@ -340,68 +397,126 @@ int set_var (char **parsed_words, int num_of_words) {
  */
 int read_and_exec_file (char *filename) {
 	char line[MAX_LINE_LENGTH];
-	FILE *file;
+	program_t *program;
+	int i;
 
 	// Checks if filename is null
 	if (!filename) {
 		return -1;
 	}
 
-	file = fopen(filename, "r");
+	program = load_program(filename);
 
-	// If the file exists, read each line
-	if (file) {
-		while (fgets(line, MAX_LINE_LENGTH, file)) {
-			run_line_from_script(line, NULL, 0);
+	// If the file exists, execute each line
+	if (program) {
+		for (i = 0; i < program->line_count; i++) {
+			run_instruction(program, i, NULL, NULL, 0, line);
 		}
-		fclose(file);
+		release_program(program);
 		return 0;
 	}
 	return -2;
 }
 
 /* ----------------------------------------------------------------------------
- * @brief Executes a line from a script.
- * @param input  - cmd    - A string of command
+ * @brief Executes a line of a compiled script. The line is echoed unless the
+ *        console is quiet, copied into the buffer and split at its
+ *        precomputed word offsets.
+ * @param input  - program - A compiled script
+ *        input  - line    - The index of the line to execute
+ *        input  - text    - The text of the line. NULL to use the program's
+ *        input  - pcb     - The process executing the line
+ *        input  - is_cpu  - Does the line come from the CPU
+ *        input  - buffer  - A line buffer of MAX_CMD_LENGTH bytes (destroyed)
  * ----------------------------------------------------------------------------
  */
-void run_line_from_script(char *line, pcb_t *pcb, int is_cpu) {
-	int err, i;
-	char **words;
-	char trimmed_cmd[MAX_CMD_LENGTH];
-	int trimmed_cmd_len;
-	int num_of_words;
+void run_instruction(program_t *program,
+                     int line,
+                     char *text,
+                     pcb_t *pcb,
+                     int is_cpu,
+                     char *buffer) {
+	int i, err;
+	char *words[MAX_WORDS];
+	instruction_t *instruction = &program->code[line];
+	word_t *word;
 
-	words = malloc(sizeof(char *) * (MAX_CMD_LENGTH / 2));
-	for (i = 0; i < (MAX_CMD_LENGTH / 2); i++) {
-		words[i] = malloc(MAX_CMD_LENGTH);
+	if (!text) {
+		text = program->text + instruction->line_offset;
 	}
 
-
-	printf("$%s", line);
-	trimmed_cmd_len = trim(line, strlen(line), trimmed_cmd);
-
-	// Parse through the user input
-	if (trimmed_cmd_len > 0) {
-		num_of_words = parser(trimmed_cmd, words);
-	} else {
-		num_of_words = 0;
+	if (is_echo_enabled()) {
+		printf("$%.*s", instruction->line_length, text);
 	}
 
-	err = interpret(words, num_of_words, pcb, is_cpu);
-	
-	for (i = 0; i < (MAX_CMD_LENGTH / 2); i++) {
-		free(words[i]);
+	// Build the words in the buffer
+	memcpy(buffer, text, instruction->line_length);
+	for (i = 0; i < instruction->word_count; i++) {
+		word = &program->words[instruction->first_word + i];
+		words[i] = buffer + word->offset;
+		words[i][word->length] = '\0';
 	}
-	free(words);
+
+	err = execute_command(instruction->opcode, words,
+	                      instruction->word_count, pcb, is_cpu);
 	handle_error(err);
 
 	// Clear line
-	printf("\n");
+	if (is_echo_enabled()) {
+		printf("\n");
+	}
+}
+
+/* ----------------------------------------------------------------------------
+ * @brief Queues a script for exec if it can be read.
+ * @param input  - filename - The script
+ * @return int - Status code
+ *                  0 - No errors
+ *                 -1 - The script cannot be found or queued
+ * ----------------------------------------------------------------------------
+ */
+int exec_script(char *filename) {
+	if (access(filename, R_OK) != 0) {
+		printf("%s cannot be found\n", filename);
+		return -1;
+	}
+	return queue_script(filename);
 }
 
 /* ----------------------------------------------------------------------------
- * @brief Executes scripts concurrently.
+ * @brief Queues every script listed in a manifest, one per line. Empty lines
+ *        and lines starting with # are ignored.
+ * @param input  - manifest - The manifest
+ * @return int - Status code
+ *                  0 - No errors
+ *                 -1 - The manifest cannot be found
+ * ----------------------------------------------------------------------------
+ */
+int exec_manifest(char *manifest) {
+	char line[MAX_FILENAME_LENGTH];
+	FILE *file;
+	int length;
+
+	file = fopen(manifest, "r");
+	if (!file) {
+		printf("%s cannot be found\n", manifest);
+		return -1;
+	}
+	while (fgets(line, MAX_FILENAME_LENGTH, file)) {
+		length = strcspn(line, "\r\n");
+		line[length] = '\0';
+		if (length > 0 && line[0] != '#') {
+			exec_script(line);
+		}
+	}
+	fclose(file);
+	return 0;
+}
+
+/* ----------------------------------------------------------------------------
+ * @brief Executes scripts concurrently. Any number of scripts may be given,
+ *        directly or as manifests prefixed with @. The scripts are queued and
+ *        loaded as the admission limit allows.
  * @param input  - parsed_words  - An array of strings
  *        input  - num_of_words  - Number of elements in the array
  * @return int - Status code
@@ -409,26 +524,20 @@ void run_line_from_script(char *line, pcb_t *pcb, int is_cpu) {
  *                 -7 - Number of arguments is not as expected
  * ----------------------------------------------------------------------------
  */
-int exec(char **parsed_words, int num_of_words, int is_cpu) {
-	FILE *file;
+int exec(char **parsed_words, int num_of_words, void *pcb, int is_cpu) {
 	int i = 0;
-	if (num_of_words > 4 || num_of_words < 2) {
-		printf(GENERIC_EXPECTED_MSG "exec <script1> [<script2>] "
-		       "[<script3>]\n"); 
-		return -7;
-	}
 
-	// Load into memory
 	for (i = 1; i < num_of_words; i++) {
-		file = fopen(parsed_words[i], "r");
-
-		if (!file) {
-			printf("%s cannot be found\n", parsed_words[i]);
+		if (parsed_words[i][0] == MANIFEST_PREFIX) {
+			exec_manifest(parsed_words[i] + 1);
 		} else {
-			launcher(file);
+			exec_script(parsed_words[i]);
 		}
 	}
 
+	// Load into memory
+	admit_scripts();
+
 	if (is_cpu == 0) {
 		scheduler();
 	}
@@ -437,23 +546,18 @@ int exec(char **parsed_words, int num_of_words, int is_cpu) {
 }
 
 /* ----------------------------------------------------------------------------
- * @brief Mounts a partition.
+ * @brief Mounts a partition. A process running on a CPU is blocked until the
+ *        I/O worker performed the mount, so that its reads and writes reach
+ *        the partition mounted when they were issued.
  * @param input  - parsed_words  - An array of strings
  *        input  - num_of_words  - Number of elements in the array
  *        input  - is_cpu        - Is the command coming from the CPU
  * @return int - Status code
- *                  0 - No errors
+ *                  0 - No errors or the process is blocked
  *                 -9 - Unexpected number of arguments or format
  * ----------------------------------------------------------------------------
  */
-int mount_cmd(char **parsed_words, int num_of_words, int is_cpu) {
-	int total_blocks, block_size;
-	if (num_of_words != 4) {
-		printf(GENERIC_EXPECTED_MSG "mount <partition_name> "
-		       "<number_of_blocks> <block_size>");
-		return -9;
-	}
-
+int mount_cmd(char **parsed_words, int num_of_words, void *pcb, int is_cpu) {
 	if (!is_number(parsed_words[2])) {
 		printf(GENERIC_EXPECTED_MSG "<number_of_blocks> "
 		       "should be an integer");
@@ -466,13 +570,28 @@ int mount_cmd(char **parsed_words, int num_of_words, int is_cpu) {
 		return -9;
 	}
 
-	if (is_cpu == 0) {
-		printf(GENERIC_ERROR_MSG
-		       "this command can only be executed from an exec script\n");
-		return -9;
+	// Mounts after the reads and writes the process issued before
+	if (is_cpu && pcb &&
+	    block_on_io(mount_partition, parsed_words, num_of_words, pcb) == 0) {
+		return 0;
 	}
+	return mount_partition(parsed_words, num_of_words, pcb);
+}
+
+/* ----------------------------------------------------------------------------
+ * @brief Performs a mount. See mount_cmd.
+ * @param input  - parsed_words  - An array of strings
+ *        input  - num_of_words  - Number of elements in the array
+ *        input  - pcb           - The process mounting
+ * @return int - Status code
+ *                  0 - No errors
+ * ----------------------------------------------------------------------------
+ */
+int mount_partition(char **parsed_words, int num_of_words, pcb_t *pcb) {
+	int total_blocks, block_size;
 
 	// Checks if the file exists, if so mount. If not, format and mount
+	lock_disk();
 	if (mount(parsed_words[1]) == 0) {
 		total_blocks = atoi(parsed_words[2]);
 		block_size = atoi(parsed_words[3]);
@@ -485,31 +604,46 @@ int mount_cmd(char **parsed_words, int num_of_words, int is_cpu) {
 	} else {
 		printf("%s has been mounted\n", parsed_words[1]);
 	}
+	unlock_disk();
 
 	return 0;
 }
 
 /* ----------------------------------------------------------------------------
- * @brief Writes a string to a file in a partition.
+ * @brief Writes a string to a file in a partition. A process running on a
+ *        CPU is blocked until the I/O worker performed the write.
  * @param input  - parsed_words  - An array of strings
  *        input  - num_of_words  - Number of elements in the array
  *        input  - is_cpu        - Does the command come from the cpu
  * @return int - Status code
- *                  0 - No errors
+ *                  0 - No errors or the process is blocked
  *                 -10- Unexpected number of arguments or format
  * ----------------------------------------------------------------------------
  */
-int write_cmd(char **parsed_words, int num_of_words, pcb_t *pcb, int is_cpu) {
+int write_cmd(char **parsed_words, int num_of_words, void *pcb, int is_cpu) {
+	// Let the other processes run while the disk is written
+	if (is_cpu && pcb &&
+	    block_on_io(write_file, parsed_words, num_of_words, pcb) == 0) {
+		return 0;
+	}
+	return write_file(parsed_words, num_of_words, pcb);
+}
+
+/* ----------------------------------------------------------------------------
+ * @brief Performs a write. See write_cmd.
+ * @param input  - parsed_words  - An array of strings
+ *        input  - num_of_words  - Number of elements in the array
+ *        input  - pcb           - The process writing
+ * @return int - Status code
+ *                  0 - No errors
+ *                 -10- Unexpected format
+ * ----------------------------------------------------------------------------
+ */
+int write_file(char **parsed_words, int num_of_words, pcb_t *pcb) {
 	char *buffer;
 	int i, j, count, fat, err;
 	char data[MAX_CMD_LENGTH];
 
-	// Verifies that all arguments are present
-	if (num_of_words < 3) {
-		printf(GENERIC_EXPECTED_MSG "write <filename> <words>\n");
-		return -10;
-	}
-
 	// Check that the input is enclosed with square brackets
 	if (parsed_words[2][0] != '[' ||
 	    parsed_words[num_of_words - 1]
@@ -519,13 +653,6 @@ int write_cmd(char **parsed_words, int num_of_words, pcb_t *pcb, int is_cpu) {
 		return -10;
 	}
 
-	// Only exec scripts are allowed to execute this command
-	if (is_cpu == 0) {
-		printf(GENERIC_ERROR_MSG
-		       "this command can only be exected in an exec script\n");
-		return -10;
-	}
-
 	// Clean the outbound buffer
 	for (i = 0; i < MAX_CMD_LENGTH; i++) {
 		data[i] = '\0';
@@ -554,17 +681,22 @@ int write_cmd(char **parsed_words, int num_of_words, pcb_t *pcb, int is_cpu) {
 	}
 
 	// Open the file specified in parsed_words[1] from the partition
+	lock_disk();
 	fat = open_file(parsed_words[1]);
 	fat = fat << 1;
 	if (fat != -1) {
 		buffer = IO_scheduler(data, pcb, fat + 1);
+		unlock_disk();
+		lock_shell_memory();
 		err = insert(0, parsed_words[2], buffer);
 		if (err == -1) {
 			// Key was found so update value
 			err = update_value_by_key(parsed_words[2], buffer);
 		}
+		unlock_shell_memory();
 		free(buffer);
 	} else {
+		unlock_disk();
 		printf(GENERIC_ERROR_MSG "cannot open new fp or FAT is full\n");
 		return -10;
 	}
@@ -573,34 +705,45 @@ int write_cmd(char **parsed_words, int num_of_words, pcb_t *pcb, int is_cpu) {
 }
 
 /* ----------------------------------------------------------------------------
- * @brief Executes scripts concurrently.
+ * @brief Reads a file in a partition into a variable. A process running on a
+ *        CPU is blocked until the I/O worker performed the read.
  * @param input  - parsed_words  - An array of strings
  *        input  - num_of_words  - Number of elements in the array
  *        input  - is_cpu        - Does the command come from the cpu
  * @return int - Status code
+ *                  0 - No errors or the process is blocked
+ *                 -10- The file could not be read
+ * ----------------------------------------------------------------------------
+ */
+int read_cmd(char **parsed_words, int num_of_words, void *pcb, int is_cpu) {
+	// Let the other processes run while the disk is read
+	if (is_cpu && pcb &&
+	    block_on_io(read_file, parsed_words, num_of_words, pcb) == 0) {
+		return 0;
+	}
+	return read_file(parsed_words, num_of_words, pcb);
+}
+
+/* ----------------------------------------------------------------------------
+ * @brief Performs a read. See read_cmd.
+ * @param input  - parsed_words  - An array of strings
+ *        input  - num_of_words  - Number of elements in the array
+ *        input  - pcb           - The process reading
+ * @return int - Status code
  *                  0 - No errors
- *                 -11- Number of arguments is not as expected
+ *                 -10- The file could not be read
  * ----------------------------------------------------------------------------
  */
-int read_cmd(char **parsed_words, int num_of_words, pcb_t *pcb, int is_cpu) {
+int read_file(char **parsed_words, int num_of_words, pcb_t *pcb) {
 	char *buffer;
 	int fat, err;
-	if (num_of_words != 3) {
-		printf(GENERIC_EXPECTED_MSG "read <filename> <variable_name>\n");
-		return -11;
-	}
-
-	// Only exec scripts are allowed to execute this command
-	if (is_cpu == 0) {
-		printf(GENERIC_ERROR_MSG
-		       "this command can only be executed in an exec script\n");
-		return -11;
-	}
 
+	lock_disk();
 	fat = open_file(parsed_words[1]);
 	fat = fat << 1;
 	if (fat != -1) {
 		buffer = IO_scheduler("", pcb, fat);
+		unlock_disk();
 
 		if (strlen(buffer) == 0) {
 			printf(GENERIC_ERROR_MSG "%s does not exist\n",
@@ -608,13 +751,16 @@ int read_cmd(char **parsed_words, int num_of_words, pcb_t *pcb, int is_cpu) {
 			return -10;
 		}
 
+		lock_shell_memory();
 		err = insert(0, parsed_words[2], buffer);
 		if (err == -1) {
 			// Key was found so update value
 			err = update_value_by_key(parsed_words[2], buffer);
 		}
+		unlock_shell_memory();
 		free(buffer);
 	} else {
+		unlock_disk();
 		printf(GENERIC_ERROR_MSG "cannot open new fp or FAT is full\n");
 		return -10;
 	}
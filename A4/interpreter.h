@@ -12,6 +12,17 @@
 /*
  * Available functions from the interpreter
  */
+void init_interpreter();
 int interpret(char **parsed_words, int num_of_words, pcb_t *pcb, int is_cpu);
+int execute_command(int opcode,
+                    char **parsed_words,
+                    int num_of_words,
+                    pcb_t *pcb,
+                    int is_cpu);
 int is_number(char *word);
-void run_line_from_script(char *line, pcb_t *pcb, int is_cpu);
+void run_instruction(program_t *program,
+                     int line,
+                     char *text,
+                     pcb_t *pcb,
+                     int is_cpu,
+                     char *buffer);
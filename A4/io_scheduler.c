@@ -9,8 +9,12 @@
 #include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
+#include <pthread.h>
 #include "io_scheduler.h"
 #include "disk_driver.h"
+#include "kernel.h"
+#include "shell.h"
+#include "console.h"
 #include "constant.h"
 
 int current = 0;
@@ -24,11 +28,145 @@ const int SIZE_OF_WAIT_QUEUE = sizeof(wait_queue) / sizeof(struct WAIT_QUEUE);
 const int FAT_MASK = 0x3E;
 const int CMD_MASK = 0x01;
 
+/*
+ * Requests of the blocked processes, serviced in order by the I/O worker.
+ * Serviced requests are kept on a free list for the next ones. Guarded by
+ * request_lock.
+ */
+pthread_mutex_t request_lock = PTHREAD_MUTEX_INITIALIZER;
+pthread_cond_t request_ready = PTHREAD_COND_INITIALIZER;
+io_request_t *requests_first;
+io_request_t *requests_last;
+io_request_t *free_requests;
+pthread_t io_worker;
+
 int find_free_position();
 void strip_irrelevant_values(char *input);
+void *service_requests(void *argument);
+
+/* ----------------------------------------------------------------------------
+ * @brief Starts the I/O worker. This code should be called only a single
+ *        time.
+ * @return int - Status code
+ *                  0 - No errors
+ *                 -1 - The worker could not be started
+ * ----------------------------------------------------------------------------
+ */
+int init_io_worker() {
+	if (pthread_create(&io_worker, NULL, service_requests, NULL) != 0) {
+		return -1;
+	}
+	pthread_detach(io_worker);
+	return 0;
+}
+
+/* ----------------------------------------------------------------------------
+ * @brief Blocks a process on an I/O request. The request is only given to the
+ *        I/O worker by submit_io once the CPU stopped running the process.
+ * @param input  - handler      - Performs the I/O
+ *        input  - parsed_words - The words of the line
+ *        input  - num_of_words - Number of words
+ *        input  - pcb          - The process to block
+ * @return int - Status code
+ *                  0 - No errors
+ *                 -1 - Memory could not be allocated
+ * ----------------------------------------------------------------------------
+ */
+int block_on_io(io_handler_t handler, char **parsed_words, int num_of_words,
+                pcb_t *pcb) {
+	io_request_t *request;
+	int i, length, used;
+
+	pthread_mutex_lock(&request_lock);
+	request = free_requests;
+	if (request) {
+		free_requests = request->next;
+	}
+	pthread_mutex_unlock(&request_lock);
+	if (!request) {
+		request = (io_request_t *) malloc(sizeof(io_request_t));
+		if (!request) {
+			return -1;
+		}
+	}
+
+	// The words of a line always fit in a line
+	used = 0;
+	for (i = 0; i < num_of_words; i++) {
+		length = strlen(parsed_words[i]);
+		request->words[i] = request->text + used;
+		memcpy(request->words[i], parsed_words[i], length + 1);
+		used += length + 1;
+	}
+	request->handler = handler;
+	request->pcb = pcb;
+	request->num_of_words = num_of_words;
+	request->next = NULL;
+
+	pcb->io_request = request;
+	pcb->state = PCB_BLOCKED;
+	return 0;
+}
+
 /* ----------------------------------------------------------------------------
- * @brief Since the program assumes there is no parallel processing,
- *        immediately process the request after it was scheduled.
+ * @brief Puts the request of a blocked process in the wait queue.
+ * @param input  - pcb - A process blocked by block_on_io
+ * ----------------------------------------------------------------------------
+ */
+void submit_io(pcb_t *pcb) {
+	pthread_mutex_lock(&request_lock);
+	if (requests_last) {
+		requests_last->next = pcb->io_request;
+	} else {
+		requests_first = pcb->io_request;
+	}
+	requests_last = pcb->io_request;
+	pthread_cond_signal(&request_ready);
+	pthread_mutex_unlock(&request_lock);
+}
+
+/* ----------------------------------------------------------------------------
+ * @brief Services the wait queue forever. The process of each request goes
+ *        back to the ready queue once its I/O completed.
+ * @param input  - argument - Unused
+ * @return NULL
+ * ----------------------------------------------------------------------------
+ */
+void *service_requests(void *argument) {
+	io_request_t *request;
+	pcb_t *pcb;
+
+	while (1) {
+		pthread_mutex_lock(&request_lock);
+		while (!requests_first) {
+			pthread_cond_wait(&request_ready, &request_lock);
+		}
+		request = requests_first;
+		requests_first = request->next;
+		if (!requests_first) {
+			requests_last = NULL;
+		}
+		pthread_mutex_unlock(&request_lock);
+
+		pcb = request->pcb;
+		handle_error(request->handler(request->words, request->num_of_words,
+		                              pcb));
+		flush_console();
+
+		pthread_mutex_lock(&request_lock);
+		request->next = free_requests;
+		free_requests = request;
+		pthread_mutex_unlock(&request_lock);
+
+		pcb->io_request = NULL;
+		unblock_process(pcb);
+	}
+	return NULL;
+}
+
+/* ----------------------------------------------------------------------------
+ * @brief Performs a request right away. Called by the I/O worker, or by the
+ *        CPU when its process cannot block.
  * @param input  - data - The data to be written to the file
  *        input  - pcb  - 
  *        input  - cmd  - The command to be processed masked with the FAT id
@@ -37,6 +175,7 @@ void strip_irrelevant_values(char *input);
  */
 char *IO_scheduler(char *data, pcb_t *ptr, int cmd) {
 	int i, count, skip, free_position, blocks_written;
+	unsigned long blocks_before;
 	char *buffer;
 
 	current = current % SIZE_OF_WAIT_QUEUE;
@@ -60,6 +199,7 @@ char *IO_scheduler(char *data, pcb_t *ptr, int cmd) {
 		}
 
 		blocks_written = 0;
+		blocks_before = counters.blocks_read;
 		while(read_block((cmd & FAT_MASK) >> 1) == 1) {
 			blocks_written++;
 			strncat(buffer, return_block(), get_block_size());
@@ -68,6 +208,9 @@ char *IO_scheduler(char *data, pcb_t *ptr, int cmd) {
 			}
 		}
 		strip_irrelevant_values(buffer);
+		if (ptr) {
+			ptr->counters.blocks_read += counters.blocks_read - blocks_before;
+		}
 
 		free(wait_queue[current].data);
 		wait_queue[current].data = NULL;
@@ -103,6 +246,7 @@ char *IO_scheduler(char *data, pcb_t *ptr, int cmd) {
 		}
 
 		blocks_written = 0;
+		blocks_before = counters.blocks_written;
 		while(write_block((cmd & FAT_MASK) >> 1, buffer) == 1) {
 			if (skip) {
 				break;
@@ -119,6 +263,10 @@ char *IO_scheduler(char *data, pcb_t *ptr, int cmd) {
 			}
 		}
 		free(buffer);
+		if (ptr) {
+			ptr->counters.blocks_written +=
+			    counters.blocks_written - blocks_before;
+		}
 	}
 
 	// Remove from wait queue
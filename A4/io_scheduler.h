@@ -8,4 +8,28 @@
 
 #include "pcb.h"
 
+/*
+ * Request of a blocked process. The words of the line are copied since the
+ * CPU reuses its line buffer. The handler performs the I/O on the I/O worker.
+ */
+#ifndef IO_SCHEDULER_H
+#define IO_SCHEDULER_H
+typedef int (*io_handler_t)(char **parsed_words, int num_of_words,
+                            pcb_t *pcb);
+
+typedef struct io_request io_request_t;
+struct io_request {
+	io_handler_t handler;
+	pcb_t *pcb;
+	int num_of_words;
+	char *words[MAX_WORDS];
+	char text[MAX_CMD_LENGTH];
+	io_request_t *next;
+};
+#endif
+
 char *IO_scheduler(char *data, pcb_t *ptr, int cmd);
+int init_io_worker();
+int block_on_io(io_handler_t handler, char **parsed_words, int num_of_words,
+                pcb_t *pcb);
+void submit_io(pcb_t *pcb);
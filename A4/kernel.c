@@ -9,170 +9,620 @@
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/resource.h>
 #include "kernel.h"
 #include "disk_driver.h"
 #include "cpu.h"
 #include "ram.h"
 #include "shellmemory.h"
 #include "shell.h"
+#include "interpreter.h"
+#include "console.h"
+#include "benchmark.h"
+#include "backing_store.h"
+#include "memorymanager.h"
+#include "policy.h"
+#include "replacement.h"
+#include "io_scheduler.h"
 
 /*
- * Ready queue and pcb_node implemented as FIFO and RR
+ * Processes are queued by the selected policy, round robin by default. A CPU
+ * without work sleeps on cpu_idle until a process is queued, or until no CPU
+ * is busy and no process is blocked on I/O anymore.
  */
-typedef struct pcb_node pcb_node_t;
-struct pcb_node {
-	pcb_t *pcb;
-	pcb_node_t *next;
+
+pthread_mutex_t idle_lock = PTHREAD_MUTEX_INITIALIZER;
+pthread_cond_t cpu_idle = PTHREAD_COND_INITIALIZER;
+int sleeping_cpus = 0;
+int busy_cpus = 0;
+int blocked_processes = 0;
+int scheduling = 0;
+
+/*
+ * Scripts waiting to be loaded. A script is admitted while fewer processes
+ * than the admission limit are live, so that processes do not outnumber the
+ * frames and the file descriptors. Each live process holds the descriptor
+ * of its file in the backing store while frames hold the text of their page.
+ * Guarded by admission_lock, which is taken before the frames.
+ */
+typedef struct pending_script pending_script_t;
+struct pending_script {
+	pending_script_t *next;
+	double queued;
+	char filename[];
 };
 
-typedef struct ready_queue ready_queue_t;
-struct ready_queue {
-	pcb_node_t *first;
-	pcb_node_t *last;
+pthread_mutex_t admission_lock = PTHREAD_MUTEX_INITIALIZER;
+pending_script_t *pending_first;
+pending_script_t *pending_last;
+int pending_scripts = 0;
+int live_processes = 0;
+int admission_limit = 1;
+
+/*
+ * Every live process, linked through its PCB. Guarded by the frames since
+ * processes are created and freed with the frames locked.
+ */
+pcb_t *processes;
+
+// Number of CPUs and geometry of the memory requested on the command line
+int requested_cpus = 1;
+int requested_frames = DEFAULT_RAM_SIZE;
+int requested_page_size = DEFAULT_PAGE_SIZE;
+int requested_initial_frames = DEFAULT_INITIAL_FRAMES;
+int requested_max_processes = 0;
+int requested_fault_around = DEFAULT_FAULT_AROUND;
+int requested_read_ahead = DEFAULT_READ_AHEAD;
+
+/*
+ * Kernel-wide counters
+ */
+kernel_counters_t counters;
+
+/*
+ * Counters of the processes that finished during the current scheduler run,
+ * kept until the summary is printed. The totals cover every process that
+ * finished since boot.
+ */
+typedef struct finished_process finished_process_t;
+struct finished_process {
+	int pid;
+	program_t *program;
+	pcb_counters_t counters;
+	double turnaround;
 };
-ready_queue_t *queue;
+
+finished_process_t *finished;
+int finished_count = 0;
+int finished_capacity = 0;
+pcb_counters_t finished_totals;
+unsigned long finished_processes = 0;
 
 /*
  * Functions specific to kernel.c
  */
-void add_to_ready(pcb_node_t *pcb);
-pcb_node_t *remove_from_ready();
+void *dispatch(void *cpu_id);
+int has_ready_process();
+int wait_for_work();
+void wake_idle_cpus();
+void link_process(pcb_t *pcb);
+void unlink_process(pcb_t *pcb);
+int parse_boot_options(int argc, char *argv[]);
+int apply_boot_option(char *name, char *value);
+int read_boot_config(char *filename);
+int init_admission();
+void record_finished(pcb_t *pcb);
+void print_counters_header();
+void print_counters(int pid, char *state, pcb_counters_t *pcb_counters,
+                    char *name);
+void print_finished_summary();
+int compare_doubles(const void *a, const void *b);
 
 /* ----------------------------------------------------------------------------
  * @brief Initializes data structures required for this simulator
+ * @return int - Status code
+ *                  0 - No errors
+ *                 -1 - The RAM or the backing store could not be created
  * ---------------------------------------------------------------------------- 
  */
-void boot() {
-	int i = 0;
-	for (i = 0; i < RAM_SIZE; i++) {
-		ram[i] = NULL;
+int boot() {
+	// Allocate the RAM, every frame empty
+	if (init_memory() != 0) {
+		return -1;
 	}
 
-	// Recreate BackingStore if not done so already
-	system("rm -rf BackingStore");
-	system("mkdir BackingStore");
+	// Create BackingStore if not done so already, keeping the scripts
+	// stored by earlier boots
+	if (init_backing_store() != 0) {
+		printf("Cannot create " BACKING_STORE_NAME "\n");
+		return -1;
+	}
+	return 0;
 }
 
 /* ----------------------------------------------------------------------------
- * @brief Loads the program to RAM, creates the PCB, PCB node and adds the
- *        program to the ready queue.
- * @param input  - file   A file pointer
+ * @brief Loads the program to RAM, creates the PCB and adds the program to
+ *        the ready queue.
+ * @param input  - file     A file pointer
+ *        input  - program  The compiled file
+ *        input  - created  When the script was executed, turnaround being
+ *                          measured from it
  * @return int - Status Code
  *                  0 - No errors
  *                 -1 - Failed to create the PCB
  * ----------------------------------------------------------------------------
  */
-int myinit(FILE *file) {
-	pcb_node_t *pcb_node;
+int myinit(FILE *file, program_t *program, double created) {
 	pcb_t *pcb;
+	int slot;
+
+	// The PCB must be linked before the frames are released so that a CPU
+	// taking one of its frames can find it
+	lock_frames();
 	// Add the file to RAM and create the PCB
-	if (add_to_ram(file) == 0) {
-		pcb = make_pcb(file);
-		pcb_node = (pcb_node_t *) malloc(sizeof(pcb_node_t));
+	slot = add_to_ram(file);
+	if (slot >= 0) {
+		pcb = make_pcb(file, program);
 		if (!pcb) {
 			// If PCB was not created successfully, free RAM and close file
-			remove_from_ram(file);
-			fclose(file);
+			remove_from_ram(slot);
+			unlock_frames();
 			return -1;
 		}
-		if (!pcb_node) {
-			remove_from_ram(file);
-			fclose(file);
+		pcb->ram_slot = slot;
+		pcb->created = created;
+		// If PCB was successfully created, add to ready queue
+		if (add_to_ready(pcb) != 0) {
+			remove_from_ram(slot);
 			free_pcb(pcb);
+			unlock_frames();
 			return -1;
 		}
-		pcb_node->pcb = pcb;
-		// If PCB was successfully created, add to ready queue
-		add_to_ready(pcb_node);
+		link_process(pcb);
+		__atomic_add_fetch(&live_processes, 1, __ATOMIC_SEQ_CST);
 	} else {
 		// If the file was not added to RAM, close file
 		fclose(file);
+		unlock_frames();
 		return -1;
 	}
+	unlock_frames();
+	wake_idle_cpus();
 	return 0;
 }
 
 /* ----------------------------------------------------------------------------
- * @brief Mimics the scheduler.
+ * @brief Sets the admission limit. By default as many processes are loaded
+ *        as their initial frames fit in RAM. The limit is lowered so that the
+ *        processes fit in the ready queue and do not run out of file
+ *        descriptors, one per live process, whose limit is raised as far as
+ *        allowed first. At least one process is always admitted.
+ * @return int - Status code
+ *                  0 - No errors
+ * ----------------------------------------------------------------------------
+ */
+int init_admission() {
+	struct rlimit limit;
+	long descriptors;
+
+	admission_limit = requested_max_processes;
+	if (admission_limit == 0) {
+		admission_limit = get_ram_size() / get_initial_frames();
+	}
+
+	// Every loaded process must fit in the ready queue at once
+	if (admission_limit > READY_QUEUE_CAPACITY) {
+		admission_limit = READY_QUEUE_CAPACITY;
+	}
+
+	if (getrlimit(RLIMIT_NOFILE, &limit) == 0) {
+		if (limit.rlim_cur < limit.rlim_max) {
+			limit.rlim_cur = limit.rlim_max;
+			setrlimit(RLIMIT_NOFILE, &limit);
+			getrlimit(RLIMIT_NOFILE, &limit);
+		}
+		descriptors = limit.rlim_cur == RLIM_INFINITY ? MAX_RAM_SIZE * 2L :
+		              (long) limit.rlim_cur;
+		descriptors -= RESERVED_DESCRIPTORS +
+		               (long) requested_cpus * CPU_DESCRIPTORS;
+		if (descriptors < 1) {
+			descriptors = 1;
+		}
+		if (admission_limit > descriptors) {
+			admission_limit = (int) descriptors;
+		}
+	}
+	return 0;
+}
+
+/* ----------------------------------------------------------------------------
+ * @brief Queues a script to be loaded by admit_scripts. The turnaround of
+ *        its process starts when it is queued.
+ * @param input  - filename - The script
+ * @return int - Status code
+ *                  0 - No errors
+ *                 -1 - Memory could not be allocated
+ * ----------------------------------------------------------------------------
+ */
+int queue_script(char *filename) {
+	pending_script_t *script;
+
+	script = (pending_script_t *) malloc(sizeof(pending_script_t) +
+	                                     strlen(filename) + 1);
+	if (!script) {
+		return -1;
+	}
+	strcpy(script->filename, filename);
+	script->next = NULL;
+	script->queued = now_seconds();
+
+	pthread_mutex_lock(&admission_lock);
+	if (pending_last) {
+		pending_last->next = script;
+	} else {
+		pending_first = script;
+	}
+	pending_last = script;
+	pending_scripts++;
+	pthread_mutex_unlock(&admission_lock);
+	return 0;
+}
+
+/* ----------------------------------------------------------------------------
+ * @brief Loads queued scripts in order while the admission limit allows.
+ *        Called after scripts are queued and whenever a process finishes.
+ * @return int - Number of processes created
+ * ----------------------------------------------------------------------------
+ */
+int admit_scripts() {
+	pending_script_t *script;
+	FILE *file;
+	int launched = 0;
+
+	pthread_mutex_lock(&admission_lock);
+	while (pending_first &&
+	       __atomic_load_n(&live_processes, __ATOMIC_SEQ_CST) <
+	       admission_limit) {
+		script = pending_first;
+		pending_first = script->next;
+		if (!pending_first) {
+			pending_last = NULL;
+		}
+		pending_scripts--;
+
+		file = fopen(script->filename, "r");
+		if (!file) {
+			printf("%s cannot be found\n", script->filename);
+		} else if (launcher(file, script->filename, script->queued) == 1) {
+			launched++;
+		}
+		free(script);
+	}
+	pthread_mutex_unlock(&admission_lock);
+	__atomic_add_fetch(&counters.processes_launched, launched,
+	                   __ATOMIC_RELAXED);
+	return launched;
+}
+
+/* ----------------------------------------------------------------------------
+ * @brief Returns the number of scripts waiting to be loaded.
+ * ----------------------------------------------------------------------------
+ */
+int get_pending_scripts() {
+	int count;
+
+	pthread_mutex_lock(&admission_lock);
+	count = pending_scripts;
+	pthread_mutex_unlock(&admission_lock);
+	return count;
+}
+
+/* ----------------------------------------------------------------------------
+ * @brief Checks if the scheduler is running.
+ * @return int - 1 if processes are being scheduled, 0 otherwise
+ * ----------------------------------------------------------------------------
+ */
+int is_scheduling() {
+	int running;
+
+	pthread_mutex_lock(&idle_lock);
+	running = scheduling;
+	pthread_mutex_unlock(&idle_lock);
+	return running;
+}
+
+/* ----------------------------------------------------------------------------
+ * @brief Mimics the scheduler. Every CPU is driven by its own thread and
+ *        pulls processes from the ready queue until all of them finished. A
+ *        single CPU runs on the calling thread. Processes launched while the
+ *        scheduler is running are picked up by the running CPUs.
  * ----------------------------------------------------------------------------
  */
 void scheduler() {
-	pcb_node_t *pcb_node;
+	pthread_t threads[MAX_CPUS];
+	long i, started;
+
 	// Check if there are any tasks scheduled
-	if (!queue->first) {
+	pthread_mutex_lock(&idle_lock);
+	if (scheduling) {
+		pthread_mutex_unlock(&idle_lock);
+		return;
+	}
+	if (!get_policy()->has_ready()) {
+		pthread_mutex_unlock(&idle_lock);
 		printf("No tasks scheduled on the ready queue\n");
 		return;
 	}
+	scheduling = 1;
+	pthread_mutex_unlock(&idle_lock);
 
 	// Indicate start of execution
 	printf("Start execution...\n\n");
-	pcb_node = remove_from_ready();
-	while(pcb_node) {
-		// Switch the pcb into the cpu
-		context_switch(pcb_node->pcb);
-		// Execute
-		if (run() == 0) {
-			// Process still has lines add back to ready queue
-			add_to_ready(pcb_node);
-		} else {
-			// Free up RAM and PCB
-			remove_from_ram(pcb_node->pcb->pc);
-			free_pcb(pcb_node->pcb);
-			free(pcb_node);
+	started = 0;
+	if (get_cpu_count() > 1) {
+		for (i = 0; i < get_cpu_count(); i++) {
+			if (pthread_create(&threads[i], NULL, dispatch, (void *) i) != 0) {
+				break;
+			}
+			started++;
 		}
-
-		// Obtain the next PCB node from the ready_queue
-		pcb_node = remove_from_ready();
 	}
+	if (started == 0) {
+		dispatch((void *) 0);
+	}
+	for (i = 0; i < started; i++) {
+		pthread_join(threads[i], NULL);
+	}
+
+	pthread_mutex_lock(&idle_lock);
+	scheduling = 0;
+	pthread_mutex_unlock(&idle_lock);
+
 	printf("Execution completed...\n");
+	print_finished_summary();
+}
+
+/* ----------------------------------------------------------------------------
+ * @brief Runs processes on a CPU. A CPU is busy from the moment it tries to
+ *        take a process until its run queue is empty, so every live process
+ *        is either on the ready queue, on the run queue of a busy CPU or
+ *        blocked. Returns once the ready queue is empty, no CPU is busy and no
+ *        process is blocked.
+ * @param input  - cpu_id - The CPU to drive
+ * @return NULL
+ * ----------------------------------------------------------------------------
+ */
+void *dispatch(void *cpu_id) {
+	int id = (int) (long) cpu_id;
+	pcb_t *pcb;
+	int status, lines_run;
+	unsigned long lines;
+
+	do {
+		__atomic_add_fetch(&busy_cpus, 1, __ATOMIC_SEQ_CST);
+		// Obtain the next PCB
+		pcb = remove_from_ready(id);
+		while(pcb) {
+			pcb->state = PCB_RUNNING;
+			lines_run = 0;
+			if (!has_next_line(pcb)) {
+				// Blocked on its last line, it finishes once its I/O completed
+				status = -1;
+			} else {
+				// Switch the pcb into the cpu
+				context_switch(id, pcb, get_policy()->quantum(pcb));
+				// Execute
+				lines = pcb->counters.lines;
+				status = run(id);
+				lines_run = (int) (pcb->counters.lines - lines);
+			}
+
+			// Batched output is written once per quantum
+			flush_console();
+
+			if (status == 0) {
+				// Process still has lines add back to the run queue
+				if (preempt_process(id, pcb, lines_run) != 0) {
+					// No room to queue it, keep running it
+					continue;
+				}
+			} else if (status == 1) {
+				// The I/O worker queues the process once its I/O completed
+				__atomic_add_fetch(&blocked_processes, 1, __ATOMIC_SEQ_CST);
+				submit_io(pcb);
+			} else {
+				// Free up RAM and PCB
+				lock_frames();
+				unlink_process(pcb);
+				record_finished(pcb);
+				remove_from_ram(pcb->ram_slot);
+				free_pcb(pcb);
+				unlock_frames();
+				__atomic_sub_fetch(&live_processes, 1, __ATOMIC_SEQ_CST);
+
+				// Load the scripts waiting for the room it left
+				admit_scripts();
+			}
+
+			pcb = remove_from_ready(id);
+		}
+		__atomic_sub_fetch(&busy_cpus, 1, __ATOMIC_SEQ_CST);
+		wake_idle_cpus();
+	} while(wait_for_work());
+
+	return NULL;
+}
+
+/* ----------------------------------------------------------------------------
+ * @brief Checks if an idle CPU could take a process from the policy.
+ * @return int - 1 if a process may be available, 0 otherwise
+ * ----------------------------------------------------------------------------
+ */
+int has_ready_process() {
+	return get_policy()->has_ready();
+}
+
+/* ----------------------------------------------------------------------------
+ * @brief Puts an idle CPU to sleep until there may be work.
+ * @return int - 1 if a process may be available or is blocked, 0 if every
+ *               process finished
+ * ----------------------------------------------------------------------------
+ */
+int wait_for_work() {
+	int work;
+
+	pthread_mutex_lock(&idle_lock);
+	__atomic_add_fetch(&sleeping_cpus, 1, __ATOMIC_SEQ_CST);
+	while(!has_ready_process() &&
+	      (__atomic_load_n(&busy_cpus, __ATOMIC_SEQ_CST) > 0 ||
+	       __atomic_load_n(&blocked_processes, __ATOMIC_SEQ_CST) > 0)) {
+		pthread_cond_wait(&cpu_idle, &idle_lock);
+	}
+	__atomic_sub_fetch(&sleeping_cpus, 1, __ATOMIC_SEQ_CST);
+	work = has_ready_process() ||
+	       __atomic_load_n(&blocked_processes, __ATOMIC_SEQ_CST) > 0;
+	pthread_mutex_unlock(&idle_lock);
+	return work;
+}
+
+/* ----------------------------------------------------------------------------
+ * @brief Wakes the sleeping CPUs after a process was queued or a CPU stopped
+ *        being busy. The lock is only taken if a CPU is sleeping.
+ * ----------------------------------------------------------------------------
+ */
+void wake_idle_cpus() {
+	// Pairs with the sleeping CPU counting itself before checking the queue
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+	if (__atomic_load_n(&sleeping_cpus, __ATOMIC_SEQ_CST) > 0) {
+		pthread_mutex_lock(&idle_lock);
+		pthread_cond_broadcast(&cpu_idle);
+		pthread_mutex_unlock(&idle_lock);
+	}
+}
+
+/* ----------------------------------------------------------------------------
+ * @brief Takes the next process of a CPU from the policy.
+ * @param input  - cpu_id  The CPU looking for work
+ * @return A PCB if a process is ready. Null otherwise
+ * ----------------------------------------------------------------------------
+ */
+pcb_t *remove_from_ready(int cpu_id) {
+	pcb_t *pcb = get_policy()->next(cpu_id);
+	if (pcb) {
+		pcb->counters.ready_time += now_seconds() - pcb->ready_since;
+	}
+	return pcb;
+}
+
+/* ----------------------------------------------------------------------------
+ * @brief Gives a process that ran out of quanta back to the policy.
+ * @param input  - cpu_id     The CPU that ran the process
+ *        input  - pcb        A pointer to a PCB
+ *        input  - lines_run  Lines executed during the quantum
+ * @return int - Status code
+ *                  0 - No errors
+ *                 -1 - Memory could not be allocated
+ * ----------------------------------------------------------------------------
+ */
+int preempt_process(int cpu_id, pcb_t *pcb, int lines_run) {
+	int shared;
+
+	pcb->state = PCB_READY;
+	pcb->ready_since = now_seconds();
+	shared = get_policy()->preempt(cpu_id, pcb, lines_run);
+	if (shared < 0) {
+		return -1;
+	}
+	// Another CPU may take the process
+	if (shared) {
+		wake_idle_cpus();
+	}
+	return 0;
+}
+
+/* ----------------------------------------------------------------------------
+ * @brief Gives a new PCB to the policy.
+ * @param input  - pcb  A pointer to a PCB
+ * @return int - Status code
+ *                  0 - No errors
+ *                 -1 - The process could not be queued
+ * ----------------------------------------------------------------------------
+ */
+int add_to_ready(pcb_t *pcb) {
+	pcb->state = PCB_READY;
+	pcb->ready_since = now_seconds();
+	return get_policy()->admit(pcb);
+}
+
+/* ----------------------------------------------------------------------------
+ * @brief Gives a process whose I/O completed back to the policy. The process
+ *        must be queued, so a full ready queue is retried until the CPUs made
+ *        room.
+ * @param input  - pcb  A blocked PCB
+ * ----------------------------------------------------------------------------
+ */
+void unblock_process(pcb_t *pcb) {
+	pcb->state = PCB_READY;
+	pcb->ready_since = now_seconds();
+	while (get_policy()->admit(pcb) != 0) {
+		sched_yield();
+	}
+	// Only counted once queued so that the CPUs keep waiting for it
+	__atomic_sub_fetch(&blocked_processes, 1, __ATOMIC_SEQ_CST);
+	wake_idle_cpus();
 }
 
 /* ----------------------------------------------------------------------------
- * @brief Removes a PCB from the ready queue.
- * @return A PCB node if the ready queue is not empty. Null otherwise
+ * @brief Adds a PCB to the list of live processes. The frames must be locked.
+ * @param input  - pcb  A pointer to a PCB
  * ----------------------------------------------------------------------------
  */
-pcb_node_t *remove_from_ready() {
-	pcb_node_t *temp;
-	if (!queue->first) {
-		// Queue is empty
-		return NULL;
-	} else if (queue->first == queue->last) {
-		// Ready queue has 1 PCB
-		temp = queue->first;
-		queue->first = NULL;
-		queue->last = NULL;
-		return temp;
+void link_process(pcb_t *pcb) {
+	pcb_t *last;
+
+	// Keep creation order so that stats lists processes by pid
+	pcb->next_process = NULL;
+	if (!processes) {
+		pcb->previous_process = pcb;
+		processes = pcb;
 	} else {
-		// Ready queue has 2 or more PCBs
-		temp = queue->first;
-		queue->first = temp->next;
-		temp->next = NULL;
-		return temp;
+		last = processes->previous_process;
+		last->next_process = pcb;
+		pcb->previous_process = last;
+		processes->previous_process = pcb;
 	}
 }
 
 /* ----------------------------------------------------------------------------
- * @brief Adds a PCB node to the ready queue.
- * @param input  - pcb_node  A pointer to a PCB node
+ * @brief Removes a PCB from the list of live processes. The frames must be
+ *        locked.
+ * @param input  - pcb  A pointer to a PCB
  * ----------------------------------------------------------------------------
  */
-void add_to_ready(pcb_node_t *pcb_node) {
-	if (!queue->first || !queue->last) {
-		// First PCB in queue
-		queue->first = pcb_node;
-		queue->last = pcb_node;
+void unlink_process(pcb_t *pcb) {
+	if (pcb == processes) {
+		processes = pcb->next_process;
+		if (processes) {
+			processes->previous_process = pcb->previous_process;
+		}
 	} else {
-		// Other PCBs are in queue
-		queue->last->next = pcb_node;
-		queue->last = pcb_node;
+		pcb->previous_process->next_process = pcb->next_process;
+		if (pcb->next_process) {
+			pcb->next_process->previous_process = pcb->previous_process;
+		} else {
+			processes->previous_process = pcb->previous_process;
+		}
 	}
+	pcb->next_process = NULL;
+	pcb->previous_process = NULL;
 }
 
 /* ----------------------------------------------------------------------------
- * @brief Finds the victim PCB and update its page table. This function is
- *        located here instead of memorymanager since it needs to look in the
- *        ready queue.
+ * @brief Finds the PCBs sharing the victim frame in the frame table and
+ *        updates their page tables. The owners may be running on a CPU. The
+ *        frames must be locked.
  * @param input  - frame_number   - An empty frame number
  *        input  - victim_number  - The victim frame
  * @return int - Status code
@@ -181,51 +631,471 @@ void add_to_ready(pcb_node_t *pcb_node) {
  * ----------------------------------------------------------------------------
  */
 int update_victim_page_table(int frame_number, int victim_number) {
-	pcb_node_t *head, *temp;
-	pcb_t *pcb;
+	frame_owner_t *owner;
+	frame_mapping_t *mapping;
+	int i;
 
 	// An empty frame is available. No need to select the victim
 	if (frame_number != -1) {
 		return -1;
 	}
 
-	head = queue->first;
-	temp = remove_from_ready();
-	// Check each pcb if it is occupying the frame
-	while(1) {
-		add_to_ready(temp);
-		pcb = temp->pcb;
-		temp = remove_from_ready();
+	// Every process sharing the frame loses its page
+	owner = get_frame_owner(victim_number);
+	for (i = 0; owner && i < owner->sharers; i++) {
+		mapping = &owner->mappings[i];
+		mapping->pcb->page_table[mapping->page_number - 1] = -1;
+		mapping->pcb->counters.evictions++;
+	}
+	release_frame(victim_number);
+	return 0;
+}
+
+/* ----------------------------------------------------------------------------
+ * @brief Keeps the counters of a finished process until the scheduler prints
+ *        its summary. The program is retained so that its name outlives the
+ *        PCB. The frames must be locked.
+ * @param input  - pcb - The finished PCB
+ * ----------------------------------------------------------------------------
+ */
+void record_finished(pcb_t *pcb) {
+	finished_process_t *grown;
+	int capacity;
 
-		// Found the victim PCB, update its page table
-		if (pcb->page_table[victim_number] != 0) {
-			pcb->page_table[victim_number] = 0;
+	finished_totals.lines += pcb->counters.lines;
+	finished_totals.quanta += pcb->counters.quanta;
+	finished_totals.page_faults += pcb->counters.page_faults;
+	finished_totals.evictions += pcb->counters.evictions;
+	finished_totals.blocks_read += pcb->counters.blocks_read;
+	finished_totals.blocks_written += pcb->counters.blocks_written;
+	finished_totals.ready_time += pcb->counters.ready_time;
+	finished_processes++;
+
+	if (finished_count == finished_capacity) {
+		capacity = finished_capacity ? finished_capacity * 2 : PCB_POOL_CHUNK;
+		grown = (finished_process_t *) realloc(finished,
+		                          sizeof(finished_process_t) * capacity);
+		if (!grown) {
+			// The process is still part of the totals
+			return;
 		}
+		finished = grown;
+		finished_capacity = capacity;
+	}
+
+	finished[finished_count].pid = pcb->pid;
+	finished[finished_count].program = pcb->program;
+	finished[finished_count].counters = pcb->counters;
+	finished[finished_count].turnaround = now_seconds() - pcb->created;
+	retain_program(pcb->program);
+	finished_count++;
+}
+
+/* ----------------------------------------------------------------------------
+ * @brief Prints the column names of the process counters.
+ * ----------------------------------------------------------------------------
+ */
+void print_counters_header() {
+	printf("%6s %-8s %10s %8s %8s %8s %8s %8s %10s  %s\n",
+	       "PID", "State", "Lines", "Quanta", "Faults", "Evicted", "Read",
+	       "Written", "Ready(ms)", "Script");
+}
+
+/* ----------------------------------------------------------------------------
+ * @brief Prints the counters of a process on a single row.
+ * @param input  - pid          - Process id, 0 for a total
+ *        input  - state        - State of the process
+ *        input  - pcb_counters - Counters to print
+ *        input  - name         - Name of the script
+ * ----------------------------------------------------------------------------
+ */
+void print_counters(int pid, char *state, pcb_counters_t *pcb_counters,
+                    char *name) {
+	if (pid > 0) {
+		printf("%6d ", pid);
+	} else {
+		printf("%6s ", "-");
+	}
+	printf("%-8s %10lu %8lu %8lu %8lu %8lu %8lu %10.3f  %s\n",
+	       state, pcb_counters->lines, pcb_counters->quanta,
+	       pcb_counters->page_faults, pcb_counters->evictions,
+	       pcb_counters->blocks_read, pcb_counters->blocks_written,
+	       pcb_counters->ready_time * 1000.0, name);
+}
+
+/* ----------------------------------------------------------------------------
+ * @brief Orders two doubles for qsort.
+ * ----------------------------------------------------------------------------
+ */
+int compare_doubles(const void *a, const void *b) {
+	double x = *(const double *) a;
+	double y = *(const double *) b;
+	return (x > y) - (x < y);
+}
+
+/* ----------------------------------------------------------------------------
+ * @brief Prints the counters of the processes that finished during the last
+ *        scheduler run and forgets them. The turnaround of the processes,
+ *        from exec to their last line, is summarized to compare policies.
+ * ----------------------------------------------------------------------------
+ */
+void print_finished_summary() {
+	double *turnarounds;
+	double sum;
+	int i;
+
+	if (finished_count == 0) {
+		return;
+	}
+
+	printf("\nProcess statistics:\n");
+	print_counters_header();
+	turnarounds = (double *) malloc(sizeof(double) * finished_count);
+	sum = 0.0;
+	for (i = 0; i < finished_count; i++) {
+		print_counters(finished[i].pid, "Finished", &finished[i].counters,
+		               finished[i].program->filename);
+		release_program(finished[i].program);
+		sum += finished[i].turnaround;
+		if (turnarounds) {
+			turnarounds[i] = finished[i].turnaround;
+		}
+	}
+	if (turnarounds) {
+		qsort(turnarounds, finished_count, sizeof(double), compare_doubles);
+		printf("Turnaround(ms): mean %.3f, p50 %.3f, p95 %.3f, max %.3f\n",
+		       sum * 1000.0 / finished_count,
+		       turnarounds[finished_count / 2] * 1000.0,
+		       turnarounds[(finished_count * 95 - 1) / 100] * 1000.0,
+		       turnarounds[finished_count - 1] * 1000.0);
+		free(turnarounds);
+	}
+	finished_count = 0;
+	flush_console();
+}
+
+/* ----------------------------------------------------------------------------
+ * @brief Prints the counters of the processes running on the CPUs, of every
+ *        process on the ready queue, the totals of the processes finished
+ *        since boot and the counters of the PCB pool.
+ * @return int - Status code
+ *                  0 - No errors
+ * ----------------------------------------------------------------------------
+ */
+int stats_cmd(char **parsed_words, int num_of_words, void *pcb, int is_cpu) {
+	pcb_t *process;
+	pcb_counters_t process_counters;
+	pcb_pool_stats_t pool;
+	replacement_t replacement;
+	char finished_label[32];
+
+	lock_frames();
+	print_counters_header();
+	for (process = processes; process; process = process->next_process) {
+		process_counters = process->counters;
+		if (process->state == PCB_READY) {
+			// Include the wait that is still in progress
+			process_counters.ready_time +=
+			    now_seconds() - process->ready_since;
+		}
+		print_counters(process->pid,
+		               process->state == PCB_READY ? "Ready" :
+		               process->state == PCB_BLOCKED ? "Blocked" : "Running",
+		               &process_counters, process->program->filename);
+	}
+	snprintf(finished_label, sizeof(finished_label), "%lu processes",
+	         finished_processes);
+	print_counters(0, "Finished", &finished_totals, finished_label);
+	get_pcb_pool_stats(&pool);
+	replacement = *get_replacement();
+	unlock_frames();
+
+	printf("PCB pool: %lu allocated, %lu free, %lu hits, %lu misses\n",
+	       pool.allocated, pool.free, pool.hits, pool.misses);
+	printf("Page replacement: %s, %lu hits, %lu misses\n",
+	       replacement.name, replacement.hits, replacement.misses);
+	printf("Pages loaded ahead: %lu, %lu faults avoided\n",
+	       counters.pages_prefetched, counters.faults_avoided);
+	printf("Pages shared: %lu\n", counters.pages_shared);
+	printf("Backing store: %lu hits, %lu misses\n", counters.store_hits,
+	       counters.store_misses);
+	return 0;
+}
+
+/* ----------------------------------------------------------------------------
+ * @brief Displays or selects the scheduling policy. Every argument after the
+ *        name of the policy must be a number. The policy can only change
+ *        while no process is scheduled.
+ * @param input  - parsed_words - An array of strings
+ *        input  - num_of_words - Number of elements in the array
+ * @return int - Status code
+ *                  0 - No errors
+ *                 -7 - Unknown policy, invalid arguments or processes are
+ *                      scheduled
+ * ----------------------------------------------------------------------------
+ */
+int sched_cmd(char **parsed_words, int num_of_words, void *pcb, int is_cpu) {
+	policy_t *policy;
+	int args[MAX_POLICY_ARGS];
+	int i, num_of_args;
+
+	if (num_of_words == 1) {
+		printf("Scheduling policy: ");
+		get_policy()->describe();
+		return 0;
+	}
 
-		// Circulated back
-		if (temp == head) {
+	policy = find_policy(parsed_words[1]);
+	num_of_args = num_of_words - 2;
+	for (i = 0; policy && i < num_of_args; i++) {
+		if (i >= MAX_POLICY_ARGS || !is_number(parsed_words[i + 2])) {
+			policy = NULL;
 			break;
 		}
+		args[i] = atoi(parsed_words[i + 2]);
+	}
+	if (!policy) {
+		printf(GENERIC_EXPECTED_MSG "sched [<policy> [<n>...]]\n");
+		print_policies();
+		return -7;
+	}
+
+	// Processes are queued while the scheduler runs, including the CPU
+	// running this command
+	if (is_scheduling()) {
+		printf(GENERIC_ERROR_MSG "cannot change the policy while processes "
+		       "are scheduled\n");
+		return -7;
+	}
+	switch (set_policy(policy, args, num_of_args)) {
+		case 0:
+			printf("Scheduling policy: ");
+			policy->describe();
+			return 0;
+		case -1:
+			printf(GENERIC_EXPECTED_MSG "sched %s\n", policy->usage);
+			return -7;
+		default:
+			printf(GENERIC_ERROR_MSG "cannot change the policy while processes "
+			       "are queued\n");
+			return -7;
+	}
+}
+
+/* ----------------------------------------------------------------------------
+ * @brief Applies a boot option that takes a value. Shared by the command line
+ *        and the configuration file.
+ * @param input  - name  - The long name of the option, without dashes
+ *        input  - value - The value of the option
+ * @return int - Status code
+ *                  0 - No errors
+ *                 -1 - Unknown option or invalid value
+ * ----------------------------------------------------------------------------
+ */
+int apply_boot_option(char *name, char *value) {
+	int number = atoi(value);
+	replacement_t *replacement;
+
+	if (strcmp(name, "replacement") == 0) {
+		replacement = find_replacement(value);
+		if (!replacement) {
+			printf("Unknown page replacement policy %s. Expected one of\n",
+			       value);
+			print_replacements();
+			return -1;
+		}
+		set_replacement(replacement);
+		return 0;
+	}
+	if (!is_number(value)) {
+		printf("The value of %s must be a number\n", name);
+		return -1;
+	}
+	if (strcmp(name, "cpus") == 0) {
+		if (number < 1 || number > MAX_CPUS) {
+			printf("The number of CPUs must be between 1 and %d\n", MAX_CPUS);
+			return -1;
+		}
+		requested_cpus = number;
+	} else if (strcmp(name, "ram") == 0) {
+		requested_frames = number;
+	} else if (strcmp(name, "page-size") == 0) {
+		requested_page_size = number;
+	} else if (strcmp(name, "initial-frames") == 0) {
+		requested_initial_frames = number;
+	} else if (strcmp(name, "max-processes") == 0) {
+		if (number < 1 || number > READY_QUEUE_CAPACITY) {
+			printf("The maximum number of processes must be between 1 and "
+			       "%d\n", READY_QUEUE_CAPACITY);
+			return -1;
+		}
+		requested_max_processes = number;
+	} else if (strcmp(name, "fault-around") == 0) {
+		requested_fault_around = number;
+	} else if (strcmp(name, "read-ahead") == 0) {
+		requested_read_ahead = number;
+	} else if (strcmp(name, "store-limit") == 0) {
+		if (configure_backing_store(number) != 0) {
+			printf("The backing store limit must be positive\n");
+			return -1;
+		}
+	} else if (strcmp(name, "quanta") == 0) {
+		if (set_default_quantum(number) != 0) {
+			printf("The quanta must be positive\n");
+			return -1;
+		}
+	} else {
+		printf("Unknown option %s\n", name);
+		return -1;
 	}
-	add_to_ready(temp);
 	return 0;
 }
 
+/* ----------------------------------------------------------------------------
+ * @brief Applies the options of a configuration file. Each line holds the
+ *        long name of an option and its value. Empty lines and lines starting
+ *        with # are ignored.
+ * @param input  - filename - The configuration file
+ * @return int - Status code
+ *                  0 - No errors
+ *                 -1 - The file cannot be read or holds an invalid option
+ * ----------------------------------------------------------------------------
+ */
+int read_boot_config(char *filename) {
+	char line[MAX_CONFIG_LINE_LENGTH];
+	char name[MAX_CONFIG_LINE_LENGTH];
+	char value[MAX_CONFIG_LINE_LENGTH];
+	FILE *file;
+	int fields, number;
 
-int main() {
-	boot();
+	file = fopen(filename, "r");
+	if (!file) {
+		printf("Cannot read %s\n", filename);
+		return -1;
+	}
+	number = 0;
+	while (fgets(line, MAX_CONFIG_LINE_LENGTH, file)) {
+		number++;
+		fields = sscanf(line, "%s %s", name, value);
+		if (fields < 1 || name[0] == '#') {
+			continue;
+		}
+		if (fields != 2 || apply_boot_option(name, value) != 0) {
+			printf("Invalid line %d of %s\n", number, filename);
+			fclose(file);
+			return -1;
+		}
+	}
+	fclose(file);
+	return 0;
+}
 
-	// Initializes the ready queue
-	queue = (ready_queue_t *) malloc(sizeof(ready_queue_t));
+/* ----------------------------------------------------------------------------
+ * @brief Applies the options given on the command line. Supports
+ *            -q, --quiet              - Do not echo executed script lines
+ *            -b, --batched            - Buffer output until a quantum ends
+ *            -c, --cpus <n>           - Number of simulated CPUs
+ *            --ram <n>                - Number of frames of RAM
+ *            --page-size <n>          - Number of lines of a page
+ *            --initial-frames <n>     - Frames loaded for a new process
+ *            --quanta <n>             - Default quanta of the policies
+ *            --max-processes <n>      - Number of processes loaded at once
+ *            --replacement <policy>   - Page replacement policy
+ *            --fault-around <n>       - Pages loaded by a page fault
+ *            --read-ahead <percent>   - Part of a page executed before the
+ *                                       next page is read ahead
+ *            --store-limit <kb>       - Size of the backing store kept
+ *                                       across boots
+ *            --config <file>          - Reads options from a file
+ *        Options are applied in order, so later options override earlier
+ *        ones.
+ * @param input  - argc - Number of arguments
+ *        input  - argv - Arguments
+ * @return int - Status code
+ *                  0 - No errors
+ *                 -1 - Unknown or invalid option
+ * ----------------------------------------------------------------------------
+ */
+int parse_boot_options(int argc, char *argv[]) {
+	int i, err;
+	for (i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "-q") == 0 || strcmp(argv[i], "--quiet") == 0) {
+			set_echo(0);
+			continue;
+		} else if (strcmp(argv[i], "-b") == 0 ||
+		           strcmp(argv[i], "--batched") == 0) {
+			set_batched(1);
+			continue;
+		}
+
+		err = -1;
+		if (i + 1 < argc) {
+			if (strcmp(argv[i], "-c") == 0) {
+				err = apply_boot_option("cpus", argv[++i]);
+			} else if (strcmp(argv[i], "--config") == 0) {
+				err = read_boot_config(argv[++i]);
+			} else if (strncmp(argv[i], "--", 2) == 0) {
+				err = apply_boot_option(argv[i] + 2, argv[i + 1]);
+				i++;
+			}
+		}
+		if (err != 0) {
+			printf("Usage: %s [-q|--quiet] [-b|--batched] [-c|--cpus <n>]\n"
+			       "       [--ram <frames>] [--page-size <lines>] "
+			       "[--initial-frames <frames>]\n"
+			       "       [--quanta <n>] [--max-processes <n>] "
+			       "[--replacement <policy>]\n"
+			       "       [--fault-around <pages>] [--read-ahead <percent>]\n"
+			       "       [--store-limit <kilobytes>] [--config <file>]\n",
+			       argv[0]);
+			return -1;
+		}
+	}
+
+	if (configure_memory(requested_frames, requested_page_size,
+	                     requested_initial_frames) != 0) {
+		printf("RAM must have between 1 and %d frames, pages between 1 and "
+		       "%d lines and between 1 initial frame and the size of RAM\n",
+		       MAX_RAM_SIZE, MAX_PAGE_SIZE);
+		return -1;
+	}
+	if (configure_prefetch(requested_fault_around,
+	                       requested_read_ahead) != 0) {
+		printf("A fault must load between 1 and %d pages and read-ahead "
+		       "start between 0 and 100%% of a page\n", MAX_FAULT_AROUND);
+		return -1;
+	}
+	return 0;
+}
+
+int main(int argc, char *argv[]) {
+	if (parse_boot_options(argc, argv) != 0) {
+		return 1;
+	}
+
+	if (boot() != 0 || init_admission() != 0) {
+		return 1;
+	}
+
+	// Initializes the queues of the scheduling policies
+	if (init_policies() != 0) {
+		return 1;
+	}
 
 	// Initializes data structures used for this assignment
-	init_cpu();
+	init_interpreter();
+	if (init_cpu(requested_cpus) != 0) {
+		return 1;
+	}
 	init_shell_memory();
 
 	// Initializes the RAM. This function still has to be called due to dependency
 	init_ram();
 
 	initIO();
+	if (init_io_worker() != 0 || init_pager() != 0) {
+		return 1;
+	}
 
 	// Keep track of errors
 	int err = 0;
@@ -10,17 +10,42 @@
 #include "pcb.h"
 
 /*
- * Global variable for RAM
+ * Kernel-wide counters
  */
-#ifndef KERNEL_RAM_H
-#define KERNEL_RAM_H
-FILE *ram[RAM_SIZE];
+#ifndef KERNEL_COUNTERS_H
+#define KERNEL_COUNTERS_H
+typedef struct kernel_counters kernel_counters_t;
+struct kernel_counters {
+	unsigned long lines;
+	unsigned long context_switches;
+	unsigned long page_faults;
+	unsigned long pages_prefetched;
+	unsigned long faults_avoided;
+	unsigned long pages_shared;
+	unsigned long store_hits;
+	unsigned long store_misses;
+	unsigned long blocks_read;
+	unsigned long blocks_written;
+	unsigned long steals;
+	unsigned long processes_launched;
+};
+extern kernel_counters_t counters;
 #endif
 
 /*
  * Available functions for the kernel
  */
 void init_ready_queue();
-int myinit(FILE *p);
+int myinit(FILE *p, program_t *program, double created);
 void scheduler();
 int update_victim_page_table(int frame_number, int victim_number);
+int add_to_ready(pcb_t *pcb);
+pcb_t *remove_from_ready(int cpu_id);
+int preempt_process(int cpu_id, pcb_t *pcb, int lines_run);
+int is_scheduling();
+int queue_script(char *filename);
+int admit_scripts();
+int get_pending_scripts();
+void unblock_process(pcb_t *pcb);
+int stats_cmd(char **parsed_words, int num_of_words, void *pcb, int is_cpu);
+int sched_cmd(char **parsed_words, int num_of_words, void *pcb, int is_cpu);
@@ -7,43 +7,243 @@
  */
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <errno.h>
 #include <unistd.h>
+#include <pthread.h>
 #include "memorymanager.h"
+#include "replacement.h"
+#include "backing_store.h"
 #include "kernel.h"
 #include "constant.h"
 
+/*
+ * Guards the frames, the page tables and the legacy RAM since every CPU may
+ * fault at the same time. A pinned frame is read by its CPU without the lock.
+ */
+pthread_mutex_t frame_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/*
+ * Geometry of the memory, set when the kernel boots
+ */
+int ram_size = DEFAULT_RAM_SIZE;
+int page_size = DEFAULT_PAGE_SIZE;
+int initial_frames = DEFAULT_INITIAL_FRAMES;
+
+/*
+ * RAM, one page per frame. The lines of a page are copied into its frame when
+ * it is loaded so that no file is kept open per frame. Sized when the kernel
+ * boots.
+ */
+frame_t *ram;
+
+/*
+ * Pages mapped to each frame, so that the owners of a victim are found
+ * without looking at every process. Guarded by the frames.
+ */
+frame_owner_t *frame_table;
+
+/*
+ * Free frames, listed in the order they were freed and linked through the
+ * frame table. Guarded by the frames.
+ */
+int free_frames_first[FRAME_FREE_LISTS];
+int free_frames_last[FRAME_FREE_LISTS];
+
+/*
+ * Frames hashed by the content of their page, chained through the frame
+ * table. Guarded by the frames.
+ */
+int *frame_buckets;
+unsigned int frame_bucket_mask;
+
+/*
+ * Pages loaded ahead of the process: the pages loaded by a fault, the
+ * faulting one included, and the percentage of a page executed before the
+ * next page is read ahead. Set when the kernel boots.
+ */
+int fault_around_pages = DEFAULT_FAULT_AROUND;
+int read_ahead_percent = DEFAULT_READ_AHEAD;
+
+/*
+ * Read-ahead requests, serviced in order by the pager. The process id tells
+ * if the PCB still belongs to the process once the frames are locked.
+ * Serviced requests are kept on a free list for the next ones. Guarded by
+ * pager_lock, which may be taken while the frames are locked.
+ */
+typedef struct page_request page_request_t;
+struct page_request {
+	pcb_t *pcb;
+	int pid;
+	int page_number;
+	page_request_t *next;
+};
+
+pthread_mutex_t pager_lock = PTHREAD_MUTEX_INITIALIZER;
+pthread_cond_t pager_ready = PTHREAD_COND_INITIALIZER;
+page_request_t *page_requests_first;
+page_request_t *page_requests_last;
+page_request_t *free_page_requests;
+pthread_t pager;
+
+/*
+ * Functions specific to memorymanager.c
+ */
+void *service_read_ahead(void *argument);
+unsigned int hash_page(program_t *program, int page_number);
+int find_shared_frame(program_t *program, int page_number, unsigned int hash);
+void hash_frame(int frame_number, unsigned int hash);
+void unhash_frame(int frame_number);
+void list_free_frame(int frame_number);
+void unlist_free_frame(int frame_number);
+
 /* ----------------------------------------------------------------------------
- * @brief Returns the number of pages required for a file.
- * @param input  - file  - A file pointer
- * @return Number of pages required for a file. -1 if the file pointer is null
+ * @brief Sets the geometry of the memory. Must be called before init_memory.
+ * @param input  - frames   - Number of frames of RAM
+ *        input  - lines    - Number of lines of a page
+ *        input  - initial  - Number of frames loaded when a process is created
+ * @return int - Status code
+ *                  0 - No errors
+ *                 -1 - A value is out of bounds
  * ----------------------------------------------------------------------------
  */
-int count_total_pages(FILE *file) {
-	// File pointer is null
-	if (!file) {
+int configure_memory(int frames, int lines, int initial) {
+	if (frames < 1 || frames > MAX_RAM_SIZE || lines < 1 ||
+	    lines > MAX_PAGE_SIZE || initial < 1 || initial > frames) {
 		return -1;
 	}
+	ram_size = frames;
+	page_size = lines;
+	initial_frames = initial;
+	return 0;
+}
 
-	char line[MAX_CMD_LENGTH];
-	int count = 0;
-	fseek(file, 0, SEEK_SET);
+/* ----------------------------------------------------------------------------
+ * @brief Sets how far ahead of a process pages are loaded.
+ * @param input  - pages   - Number of pages loaded by a fault
+ *        input  - percent - Percentage of a page executed before the next
+ *                           page is read ahead, 0 to disable read-ahead
+ * @return int - Status code
+ *                  0 - No errors
+ *                 -1 - A value is out of bounds
+ * ----------------------------------------------------------------------------
+ */
+int configure_prefetch(int pages, int percent) {
+	if (pages < 1 || pages > MAX_FAULT_AROUND ||
+	    percent < 0 || percent > 100) {
+		return -1;
+	}
+	fault_around_pages = pages;
+	read_ahead_percent = percent;
+	return 0;
+}
 
-	while (fgets(line, MAX_CMD_LENGTH, file)) {
-		count++;
+/* ----------------------------------------------------------------------------
+ * @brief Allocates the RAM and the frame table. This code should be called
+ *        only a single time.
+ * @return int - Status code
+ *                  0 - No errors
+ *                 -1 - Memory could not be allocated
+ * ----------------------------------------------------------------------------
+ */
+int init_memory() {
+	int i, buckets;
+
+	buckets = 1;
+	while (buckets < ram_size * FRAME_BUCKETS_PER_FRAME) {
+		buckets = buckets << 1;
+	}
+	ram = (frame_t *) calloc(ram_size, sizeof(frame_t));
+	frame_table = (frame_owner_t *) calloc(ram_size, sizeof(frame_owner_t));
+	frame_buckets = (int *) malloc(sizeof(int) * buckets);
+	if (!ram || !frame_table || !frame_buckets ||
+	    init_replacement(ram_size) != 0) {
+		return -1;
+	}
+	for (i = 0; i < buckets; i++) {
+		frame_buckets[i] = -1;
+	}
+	frame_bucket_mask = buckets - 1;
+	for (i = 0; i < FRAME_FREE_LISTS; i++) {
+		free_frames_first[i] = -1;
+		free_frames_last[i] = -1;
 	}
+	for (i = 0; i < ram_size; i++) {
+		frame_table[i].free_list = FRAME_NOT_FREE;
+		list_free_frame(i);
+	}
+	return 0;
+}
 
-	fseek(file, 0, SEEK_SET);
+/* ----------------------------------------------------------------------------
+ * @brief Starts the pager, which reads pages ahead of the processes, unless
+ *        read-ahead is disabled. This code should be called only a single
+ *        time, after configure_prefetch.
+ * @return int - Status code
+ *                  0 - No errors
+ *                 -1 - The pager could not be started
+ * ----------------------------------------------------------------------------
+ */
+int init_pager() {
+	if (read_ahead_percent == 0) {
+		return 0;
+	}
+	if (pthread_create(&pager, NULL, service_read_ahead, NULL) != 0) {
+		return -1;
+	}
+	pthread_detach(pager);
+	return 0;
+}
 
-	if (count % PAGE_SIZE == 0) {
-		return count / PAGE_SIZE;
+/* ----------------------------------------------------------------------------
+ * @brief Returns the number of frames of RAM.
+ * ----------------------------------------------------------------------------
+ */
+int get_ram_size() {
+	return ram_size;
+}
+
+/* ----------------------------------------------------------------------------
+ * @brief Returns the number of lines of a page.
+ * ----------------------------------------------------------------------------
+ */
+int get_page_size() {
+	return page_size;
+}
+
+/* ----------------------------------------------------------------------------
+ * @brief Returns the number of frames loaded when a process is created.
+ * ----------------------------------------------------------------------------
+ */
+int get_initial_frames() {
+	return initial_frames;
+}
+
+/* ----------------------------------------------------------------------------
+ * @brief Returns the number of pages required for a script. Every line of the
+ *        script is an instruction of its program.
+ * @param input  - program  - The compiled script
+ * @return Number of pages required for a file. -1 if the program is null
+ * ----------------------------------------------------------------------------
+ */
+int count_total_pages(program_t *program) {
+	// Program is null
+	if (!program) {
+		return -1;
+	}
+
+	int count = program->line_count;
+
+	if (count % page_size == 0) {
+		return count / page_size;
 	} else {
-		return (count / PAGE_SIZE) + 1;
+		return (count / page_size) + 1;
 	}
 }
 
 /* ----------------------------------------------------------------------------
- * @brief Finds the page at the specified page number.
+ * @brief Finds the page at the specified page number. Pages are numbered from
+ *        1.
  * @param input  - page_number - The page to be returned
  *        input  - file        - A pointer to a file (destroyed) 
  * @return A file pointer beginning at the specified page number
@@ -54,11 +254,11 @@ FILE *find_page(int page_number, FILE *file) {
 		return NULL;
 	}
 
-	if (page_number < 0) {
+	if (page_number < 1) {
 		return NULL;
 	}
 
-	int count = page_number * PAGE_SIZE;
+	int count = (page_number - 1) * page_size;
 	char line[MAX_CMD_LENGTH];
 	fseek(file, 0, SEEK_SET);
 
@@ -70,165 +270,699 @@ FILE *find_page(int page_number, FILE *file) {
 }
 
 /* ----------------------------------------------------------------------------
- * @brief Finds if the page is stored inside of memory.
- * @param input  - A file pointer to a page
+ * @brief Returns where a page starts in the file of a script. The backing
+ *        store holds a copy of the script, so the offset of each line was
+ *        recorded when its program was compiled.
+ * @param input  - program     - The compiled script
+ *        input  - page_number - The page
+ * @return The offset of the page in bytes, the size of the script if the page
+ *         is past its end. -1 if the program is null or page is invalid
+ * ----------------------------------------------------------------------------
+ */
+long get_page_offset(program_t *program, int page_number) {
+	long line;
+
+	if (!program || page_number < 1) {
+		return -1;
+	}
+	line = (long) (page_number - 1) * page_size;
+	if (line >= program->line_count) {
+		return program->text_size;
+	}
+	return program->code[line].line_offset;
+}
+
+/* ----------------------------------------------------------------------------
+ * @brief Copies the lines of a page into a frame, replacing its content. The
+ *        page is located with the program of the script and read at once.
+ * @param input  - frame       - The frame
+ *        input  - file        - A pointer to the file of the script
+ *        input  - program     - The compiled script
+ *        input  - page_number - The page to be copied
+ * @return int - Status code
+ *                  0 - No errors
+ *                 -1 - An argument is null or page is out of bounds
+ *                 -2 - Could not allocate new memory space
+ *                 -3 - The page could not be read
+ * ----------------------------------------------------------------------------
+ */
+int read_page(frame_t *frame, FILE *file, program_t *program, int page_number) {
+	long start, end;
+	int i, first, size;
+
+	start = get_page_offset(program, page_number);
+	end = get_page_offset(program, page_number + 1);
+	if (!frame || !file || start < 0 || end < start) {
+		return -1;
+	}
+	size = (int) (end - start);
+	if ((!frame->lines && !(frame->lines = (int *) malloc(
+	                           sizeof(int) * (page_size + 1)))) ||
+	    reserve((void **) &frame->text, &frame->capacity, size,
+	            sizeof(char)) != 0) {
+		frame->line_count = 0;
+		return -2;
+	}
+
+	frame->line_count = 0;
+	if (pread(fileno(file), frame->text, size, start) != size) {
+		return -3;
+	}
+
+	// Lines keep their offsets relative to the start of the page
+	first = (page_number - 1) * page_size;
+	for (i = first; i < program->line_count && i < first + page_size; i++) {
+		frame->lines[frame->line_count++] =
+			program->code[i].line_offset - (int) start;
+	}
+	frame->lines[frame->line_count] = size;
+	return 0;
+}
+
+/* ----------------------------------------------------------------------------
+ * @brief Returns a line of the page held by a frame. The frame must be locked
+ *        or pinned.
+ * @param input  - frame_number - The number of the frame
+ *        input  - offset       - The line within the page
+ * @return The text of the line. NULL if the page has no such line
+ * ----------------------------------------------------------------------------
+ */
+char *get_frame_line(int frame_number, int offset) {
+	if (frame_number < 0 || frame_number >= ram_size || offset < 0 ||
+	    offset >= ram[frame_number].line_count) {
+		return NULL;
+	}
+	return ram[frame_number].text + ram[frame_number].lines[offset];
+}
+
+/* ----------------------------------------------------------------------------
+ * @brief Finds if a page of a process is stored inside of memory.
+ * @param input  - pcb         - A pointer to a PCB
+ *        input  - page_number - The page to be found
  * @return A positive integer indicating the position of the page in memory.
  *         -1 otherwise
  * ----------------------------------------------------------------------------
  */
-int find_frame(FILE *page) {
-	int i = 0;
-	for (i = 0; i < RAM_SIZE; i++) {
-		if (ram[i] != NULL && ram[i] == page) {
-			return i;
-		}
+int find_frame(pcb_t *pcb, int page_number) {
+	if (page_number < 1 || page_number > pcb->page_table_size) {
+		return -1;
 	}
-
-	return -1;
+	return pcb->page_table[page_number - 1];
 }
 
 /* ----------------------------------------------------------------------------
- * @brief Find a victim. If a victim cannot be found after checking each frame
- *        then the initial random frame will be selected.
+ * @brief Find a victim with the page replacement policy selected at boot.
+ *        The frames of other processes are preferred and pinned frames are
+ *        never selected.
  * @param input  - pcb - The process wanting to obtain a new frame
- * @return A number between 0 and RAM_SIZE;.
+ * @return A number between 0 and the size of RAM. -1 if every frame is pinned
  * ----------------------------------------------------------------------------
  */
 int find_victim(pcb_t *pcb) {
-	int r, i;
-	
-	// Randomly select the victim
-	r = rand() % RAM_SIZE;
-	
-	// Checks that the victim is not the process itself
-	if (pcb->page_table[r] == 0) {
-		return r;
-	}
-
-	// Iteratively increase until a spot is found to be occupied by another PCB
-	for (i = r; i < r + RAM_SIZE; i++) {
-		if (pcb->page_table[i % r] == 0) {
-			return (i % r);
-		}
-	}
-
-	// The entire RAM is filled with pages of the process
-	return r;
+	return get_replacement()->victim(pcb);
 }
 
 /* ----------------------------------------------------------------------------
  * @brief Overwrites a frame with the content of page.
- * @param 
+ * @param input  - frame_number - The number of an empty frame, -1 if none
+ *        input  - victim_frame - The selected victim
+ *        input  - pcb          - The process the page belongs to
+ *        input  - page_number  - The page to be loaded
  * @return int - Status code
  *                  0 - No errors
  *                 -1 - Frame is greater than RAM size
- *                 -2 - Page is null
+ *                 -2 - Page could not be read
  * ----------------------------------------------------------------------------
  */
-int update_frame(int frame_number, int victim_frame, FILE *page) {
+int update_frame(int frame_number,
+                 int victim_frame,
+                 pcb_t *pcb,
+                 int page_number) {
 	// Checks that frame numbers are within bounds
-	if (frame_number >= RAM_SIZE || victim_frame >= RAM_SIZE) {
+	if (frame_number >= ram_size || victim_frame >= ram_size) {
 		return -1;
 	}
-	
-	// Checks that page is not null
-	if (!page) {
+
+	if (frame_number == -1) {
+		frame_number = victim_frame;
+	}
+	if (frame_number < 0) {
 		return -2;
 	}
-
-	if (frame_number != -1) {
-		if (ram[frame_number]) {
-			fclose(ram[frame_number]);
-		}
-		ram[frame_number] = page;
-	} else {
-		if (ram[victim_frame]) { 
-			fclose(ram[victim_frame]);
-		}
-		ram[victim_frame] = page;
+	unhash_frame(frame_number);
+	if (read_page(&ram[frame_number], pcb->pc, pcb->program,
+	              page_number) != 0) {
+		return -2;
 	}
+	load_frame(frame_number);
 	return 0;
 }
 
 /* ----------------------------------------------------------------------------
- * @brief Updates the PCB's page table.
+ * @brief Updates the PCB's page table and adds the page to the pages mapped
+ *        to the frame. A free frame leaves its free list.
  * @param input  - pcb          - A pointer to a PCB
  *        input  - page_number  - The page number that's being stored
  *        input  - frame_number - The number of the frame
  *        input  - victim_frame - The selected victim
  * @return int - Status code
  *                  0 - No errors
- *                 -1 - PCB is null
+ *                 -1 - PCB is null or page is out of bounds
  *                 -2 - Frame number is greater than RAM size
+ *                 -3 - Could not allocate new memory space
  * ----------------------------------------------------------------------------
  */
 int update_page_table(pcb_t *pcb,
                       int page_number,
                       int frame_number,
                       int victim_frame) {
-	if (!pcb) {
+	frame_owner_t *owner;
+
+	if (!pcb || page_number < 1 || page_number > pcb->page_table_size) {
 		return -1;
 	}
 
-	if (frame_number >= RAM_SIZE || victim_frame >= RAM_SIZE) {
+	if (frame_number >= ram_size || victim_frame >= ram_size) {
 		return -2;
 	}
 
-	if (frame_number != -1) {
-		pcb->page_table[frame_number] = page_number;
-	} else {
-		pcb->page_table[victim_frame] = page_number;
+	if (frame_number == -1) {
+		frame_number = victim_frame;
+	}
+	owner = &frame_table[frame_number];
+	if (reserve((void **) &owner->mappings, &owner->mapping_capacity,
+	            owner->sharers + 1, sizeof(frame_mapping_t)) != 0) {
+		return -3;
+	}
+	if (owner->sharers == 0) {
+		unlist_free_frame(frame_number);
+		owner->prefetched = 0;
+	}
+	owner->mappings[owner->sharers].pcb = pcb;
+	owner->mappings[owner->sharers].page_number = page_number;
+	owner->sharers++;
+	pcb->page_table[page_number - 1] = frame_number;
+
+	return 0;
+}
+
+/* ----------------------------------------------------------------------------
+ * @brief Returns the owners of a frame.
+ * @param input  - frame_number - The number of the frame
+ * @return A pointer to the owners. NULL if the frame is free or out of bounds
+ * ----------------------------------------------------------------------------
+ */
+frame_owner_t *get_frame_owner(int frame_number) {
+	if (frame_number < 0 || frame_number >= ram_size ||
+	    frame_table[frame_number].sharers == 0) {
+		return NULL;
+	}
+	return &frame_table[frame_number];
+}
+
+/* ----------------------------------------------------------------------------
+ * @brief Forgets the owners of a frame that was freed. The page stays hashed
+ *        so that a process may map it again until the frame is overwritten.
+ * @param input  - frame_number - The number of the frame
+ * ----------------------------------------------------------------------------
+ */
+void release_frame(int frame_number) {
+	if (frame_number >= 0 && frame_number < ram_size) {
+		frame_table[frame_number].sharers = 0;
+		frame_table[frame_number].prefetched = 0;
+		list_free_frame(frame_number);
+	}
+}
+
+/* ----------------------------------------------------------------------------
+ * @brief Removes a page of a process from the pages mapped to a frame. The
+ *        frame is released once no page is mapped to it. The frames must be
+ *        locked.
+ * @param input  - frame_number - The number of the frame
+ *        input  - pcb          - A process sharing the frame
+ *        input  - page_number  - The page of the process
+ * ----------------------------------------------------------------------------
+ */
+void unmap_frame(int frame_number, pcb_t *pcb, int page_number) {
+	frame_owner_t *owner = &frame_table[frame_number];
+	int i;
+
+	for (i = 0; i < owner->sharers; i++) {
+		if (owner->mappings[i].pcb == pcb &&
+		    owner->mappings[i].page_number == page_number) {
+			owner->mappings[i] = owner->mappings[--owner->sharers];
+			break;
+		}
 	}
+	pcb->page_table[page_number - 1] = -1;
+	if (owner->sharers == 0) {
+		release_frame(frame_number);
+	}
+}
 
+/* ----------------------------------------------------------------------------
+ * @brief Checks if a page of a process is mapped to a frame. The frames must
+ *        be locked.
+ * @param input  - frame_number - The number of the frame
+ *        input  - pcb          - The process
+ * @return 1 if a page of the process is mapped to the frame, 0 otherwise
+ * ----------------------------------------------------------------------------
+ */
+int is_frame_mapped(int frame_number, pcb_t *pcb) {
+	int i;
+
+	for (i = 0; i < frame_table[frame_number].sharers; i++) {
+		if (frame_table[frame_number].mappings[i].pcb == pcb) {
+			return 1;
+		}
+	}
 	return 0;
 }
 
 /* ----------------------------------------------------------------------------
- * @brief Find empty frames within RAM.
+ * @brief Hashes a page of a script using FNV-1a. The content of the page is
+ *        the text of its lines in the program.
+ * @param input  - program     - The compiled script
+ *        input  - page_number - The page
+ * @return The hash of the page
+ * ----------------------------------------------------------------------------
+ */
+unsigned int hash_page(program_t *program, int page_number) {
+	unsigned int hash = 2166136261u;
+	long i, end;
+
+	end = get_page_offset(program, page_number + 1);
+	for (i = get_page_offset(program, page_number); i < end; i++) {
+		hash ^= (unsigned char) program->text[i];
+		hash *= 16777619u;
+	}
+	return hash;
+}
+
+/* ----------------------------------------------------------------------------
+ * @brief Finds a frame holding a page with the same content as a page of a
+ *        script. The frames must be locked.
+ * @param input  - program     - The compiled script
+ *        input  - page_number - The page
+ *        input  - hash        - The hash of the page
+ * @return The number of the frame. -1 if no frame holds the content
+ * ----------------------------------------------------------------------------
+ */
+int find_shared_frame(program_t *program, int page_number, unsigned int hash) {
+	long start, size;
+	int i;
+
+	start = get_page_offset(program, page_number);
+	size = get_page_offset(program, page_number + 1) - start;
+	for (i = frame_buckets[hash & frame_bucket_mask]; i != -1;
+	     i = frame_table[i].next_hashed) {
+		if (frame_table[i].hash == hash &&
+		    ram[i].lines[ram[i].line_count] == size &&
+		    memcmp(ram[i].text, program->text + start, size) == 0) {
+			return i;
+		}
+	}
+	return -1;
+}
+
+/* ----------------------------------------------------------------------------
+ * @brief Hashes a frame by the content of its page. The frames must be locked.
+ * @param input  - frame_number - The number of the frame
+ *        input  - hash         - The hash of the page
+ * ----------------------------------------------------------------------------
+ */
+void hash_frame(int frame_number, unsigned int hash) {
+	int *bucket = &frame_buckets[hash & frame_bucket_mask];
+
+	frame_table[frame_number].hash = hash;
+	frame_table[frame_number].next_hashed = *bucket;
+	frame_table[frame_number].hashed = 1;
+	*bucket = frame_number;
+	if (frame_table[frame_number].free_list != FRAME_NOT_FREE) {
+		unlist_free_frame(frame_number);
+		list_free_frame(frame_number);
+	}
+}
+
+/* ----------------------------------------------------------------------------
+ * @brief Removes a frame from the hashed frames before its page is
+ *        overwritten. The frames must be locked.
+ * @param input  - frame_number - The number of the frame
+ * ----------------------------------------------------------------------------
+ */
+void unhash_frame(int frame_number) {
+	int *link;
+
+	if (!frame_table[frame_number].hashed) {
+		return;
+	}
+	link = &frame_buckets[frame_table[frame_number].hash & frame_bucket_mask];
+	while (*link != frame_number) {
+		link = &frame_table[*link].next_hashed;
+	}
+	*link = frame_table[frame_number].next_hashed;
+	frame_table[frame_number].hashed = 0;
+	if (frame_table[frame_number].free_list != FRAME_NOT_FREE) {
+		unlist_free_frame(frame_number);
+		list_free_frame(frame_number);
+	}
+}
+
+/* ----------------------------------------------------------------------------
+ * @brief Adds a free frame to the back of its free list, the list of the
+ *        kept frames if its page is hashed. The frames must be locked.
+ * @param input  - frame_number - The number of the frame
+ * ----------------------------------------------------------------------------
+ */
+void list_free_frame(int frame_number) {
+	frame_owner_t *owner = &frame_table[frame_number];
+	int list = owner->hashed ? FRAME_KEPT : FRAME_EMPTY;
+
+	if (owner->free_list != FRAME_NOT_FREE) {
+		return;
+	}
+	owner->free_list = list;
+	owner->next_free = -1;
+	owner->previous_free = free_frames_last[list];
+	if (free_frames_last[list] != -1) {
+		frame_table[free_frames_last[list]].next_free = frame_number;
+	} else {
+		free_frames_first[list] = frame_number;
+	}
+	free_frames_last[list] = frame_number;
+}
+
+/* ----------------------------------------------------------------------------
+ * @brief Removes a frame from its free list. The frames must be locked.
+ * @param input  - frame_number - The number of the frame
+ * ----------------------------------------------------------------------------
+ */
+void unlist_free_frame(int frame_number) {
+	frame_owner_t *owner = &frame_table[frame_number];
+	int list = owner->free_list;
+
+	if (list == FRAME_NOT_FREE) {
+		return;
+	}
+	if (owner->previous_free != -1) {
+		frame_table[owner->previous_free].next_free = owner->next_free;
+	} else {
+		free_frames_first[list] = owner->next_free;
+	}
+	if (owner->next_free != -1) {
+		frame_table[owner->next_free].previous_free = owner->previous_free;
+	} else {
+		free_frames_last[list] = owner->previous_free;
+	}
+	owner->free_list = FRAME_NOT_FREE;
+}
+
+/* ----------------------------------------------------------------------------
+ * @brief Keeps a frame from being selected as a victim while a CPU executes
+ *        it. The frames must be locked.
+ * @param input  - frame_number - The number of the frame
+ * ----------------------------------------------------------------------------
+ */
+void pin_frame(int frame_number) {
+	if (frame_number >= 0 && frame_number < ram_size) {
+		frame_table[frame_number].pins++;
+	}
+}
+
+/* ----------------------------------------------------------------------------
+ * @brief Checks if a CPU executes a frame. The frames must be locked.
+ * @param input  - frame_number - The number of the frame
+ * @return 1 if the frame is pinned, 0 otherwise
+ * ----------------------------------------------------------------------------
+ */
+int is_frame_pinned(int frame_number) {
+	return frame_table[frame_number].pins != 0;
+}
+
+/* ----------------------------------------------------------------------------
+ * @brief Releases a frame pinned by pin_frame. The frames must be locked.
+ * @param input  - frame_number - The number of the frame
+ * ----------------------------------------------------------------------------
+ */
+void unpin_frame(int frame_number) {
+	if (frame_number >= 0 && frame_number < ram_size &&
+	    frame_table[frame_number].pins > 0) {
+		frame_table[frame_number].pins--;
+	}
+}
+
+/* ----------------------------------------------------------------------------
+ * @brief Find empty frames within RAM. Frames that never held a page or were
+ *        overwritten are preferred to those keeping the page of a finished
+ *        process, which another process may still share. The frame stays on
+ *        its free list until a page is mapped to it.
  * @return A number of the position where an empty spot was found.
  *         -1 otherwise.
  * ----------------------------------------------------------------------------
  */
 int find_empty_frame() {
-	int i = 0;
-	for (i = 0; i < RAM_SIZE; i++) {
-		if (!ram[i]) {
-			return i;
+	if (free_frames_first[FRAME_EMPTY] != -1) {
+		return free_frames_first[FRAME_EMPTY];
+	}
+	return free_frames_first[FRAME_KEPT];
+}
+
+/* ----------------------------------------------------------------------------
+ * @brief Loads a page of a process into an empty frame, or into the frame of
+ *        a victim. Pages are never modified, so a frame already holding the
+ *        same content is shared instead. The frames must be locked.
+ * @param input  - pcb         - The process
+ *        input  - page_number - The page to be loaded
+ *        input  - may_evict   - 1 if a victim may be selected
+ * @return The number of the frame. -1 if no frame could be used or the page
+ *         could not be read
+ * ----------------------------------------------------------------------------
+ */
+int load_page(pcb_t *pcb, int page_number, int may_evict) {
+	int frame_number, victim_number;
+	unsigned int hash;
+
+	// Pages of any process with the same content map the same frame
+	hash = hash_page(pcb->program, page_number);
+	frame_number = find_shared_frame(pcb->program, page_number, hash);
+	if (frame_number != -1) {
+		if (update_page_table(pcb, page_number, frame_number, -1) != 0) {
+			return -1;
 		}
+		counters.pages_shared++;
+		return frame_number;
 	}
-	return -1;
+
+	// Attempt to find an empty frame and a victim frame
+	frame_number = find_empty_frame();
+	victim_number = -1;
+	if (frame_number == -1) {
+		if (!may_evict) {
+			return -1;
+		}
+		victim_number = find_victim(pcb);
+	}
+
+	// Update the victim's page table and overwrite the frame with new content
+	update_victim_page_table(frame_number, victim_number);
+	if (update_frame(frame_number, victim_number, pcb, page_number) != 0) {
+		return -1;
+	}
+	if (update_page_table(pcb, page_number, frame_number,
+	                      victim_number) != 0) {
+		return -1;
+	}
+	frame_number = frame_number != -1 ? frame_number : victim_number;
+	hash_frame(frame_number, hash);
+	return frame_number;
+}
+
+/* ----------------------------------------------------------------------------
+ * @brief Loads the pages following a faulting page into empty frames, so
+ *        that a fault loads the configured number of pages. Scripts execute
+ *        their pages in order. The frames must be locked.
+ * @param input  - pcb         - The process
+ *        input  - page_number - The faulting page
+ * ----------------------------------------------------------------------------
+ */
+void fault_around(pcb_t *pcb, int page_number) {
+	int page, frame_number;
+
+	for (page = page_number + 1;
+	     page < page_number + fault_around_pages && page <= pcb->pages_max;
+	     page++) {
+		if (find_frame(pcb, page) != -1) {
+			continue;
+		}
+		frame_number = load_page(pcb, page, 0);
+		if (frame_number == -1) {
+			break;
+		}
+		frame_table[frame_number].prefetched = 1;
+		counters.pages_prefetched++;
+	}
+}
+
+/* ----------------------------------------------------------------------------
+ * @brief Counts a fault avoided if a frame holds a page loaded ahead of its
+ *        process that is used for the first time. The frames must be locked.
+ * @param input  - frame_number - The number of the frame
+ * @return 1 if the page was loaded ahead, 0 otherwise
+ * ----------------------------------------------------------------------------
+ */
+int take_prefetched(int frame_number) {
+	if (frame_number < 0 || frame_number >= ram_size ||
+	    !frame_table[frame_number].prefetched) {
+		return 0;
+	}
+	frame_table[frame_number].prefetched = 0;
+	counters.faults_avoided++;
+	return 1;
+}
+
+/* ----------------------------------------------------------------------------
+ * @brief Asks the pager to load the next page of a process that executed
+ *        enough of its page. Each page is only requested once. The frames
+ *        must be locked.
+ * @param input  - pcb    - The process, stopped by the CPU
+ *        input  - offset - The line the process stopped at
+ * ----------------------------------------------------------------------------
+ */
+void read_ahead(pcb_t *pcb, int offset) {
+	page_request_t *request;
+	int page_number = pcb->pc_page + 1;
+
+	if (read_ahead_percent == 0 ||
+	    offset * 100 < read_ahead_percent * page_size ||
+	    page_number > pcb->pages_max ||
+	    pcb->read_ahead_page >= page_number) {
+		return;
+	}
+	pcb->read_ahead_page = page_number;
+	if (find_frame(pcb, page_number) != -1) {
+		return;
+	}
+
+	pthread_mutex_lock(&pager_lock);
+	request = free_page_requests;
+	if (request) {
+		free_page_requests = request->next;
+	} else {
+		request = (page_request_t *) malloc(sizeof(page_request_t));
+	}
+	if (request) {
+		request->pcb = pcb;
+		request->pid = pcb->pid;
+		request->page_number = page_number;
+		request->next = NULL;
+		if (page_requests_last) {
+			page_requests_last->next = request;
+		} else {
+			page_requests_first = request;
+		}
+		page_requests_last = request;
+		pthread_cond_signal(&pager_ready);
+	}
+	pthread_mutex_unlock(&pager_lock);
 }
 
 /* ----------------------------------------------------------------------------
- * @brief Copies files to the backing store and loads it into RAM
- * @param input  - file - A file pointer
+ * @brief Services the read-ahead requests forever. A request is dropped if
+ *        its process finished, moved past the page or has it in a frame.
+ * @param input  - argument - Unused
+ * @return NULL
+ * ----------------------------------------------------------------------------
+ */
+void *service_read_ahead(void *argument) {
+	page_request_t *request;
+	pcb_t *pcb;
+	int frame_number;
+
+	while (1) {
+		pthread_mutex_lock(&pager_lock);
+		while (!page_requests_first) {
+			pthread_cond_wait(&pager_ready, &pager_lock);
+		}
+		request = page_requests_first;
+		page_requests_first = request->next;
+		if (!page_requests_first) {
+			page_requests_last = NULL;
+		}
+		pthread_mutex_unlock(&pager_lock);
+
+		// PCBs are pooled, so a finished process leaves a valid PCB behind
+		lock_frames();
+		pcb = request->pcb;
+		if (pcb->pid == request->pid &&
+		    request->page_number > pcb->pc_page &&
+		    request->page_number <= pcb->pages_max &&
+		    find_frame(pcb, request->page_number) == -1) {
+			frame_number = load_page(pcb, request->page_number, 1);
+			if (frame_number != -1) {
+				frame_table[frame_number].prefetched = 1;
+				counters.pages_prefetched++;
+			}
+		}
+		unlock_frames();
+
+		pthread_mutex_lock(&pager_lock);
+		request->next = free_page_requests;
+		free_page_requests = request;
+		pthread_mutex_unlock(&pager_lock);
+	}
+	return NULL;
+}
+
+/* ----------------------------------------------------------------------------
+ * @brief Copies files to the backing store and loads it into RAM. The file is
+ *        compiled unless its program is cached or stored. The compiled program
+ *        holds the offsets of the lines of the copy.
+ * @param input  - file     - A file pointer
+ *        input  - filename - The path the file was opened from
+ *        input  - created  - When the script was executed
  * @return int - Status code
  *                  1 - No error
  *                  0 - Failed to launch program
  * ----------------------------------------------------------------------------
  */
-int launcher(FILE *file) {
-	char filename[MAX_FILENAME_LENGTH];
-	char line[MAX_CMD_LENGTH];
+int launcher(FILE *file, char *filename, double created) {
 	FILE *new_file;
+	program_t *program;
+	int err;
 
-	// Copy file to the backing store
-	sprintf(filename, "BackingStore/%p.txt", file);
-	new_file = fopen(filename, "w");
-	while (fgets(line, MAX_CMD_LENGTH, file)) {
-		fprintf(new_file, "%s", line);
-	}
-
-	// Close both files
+	// Find the script in the backing store, storing it if it is not there
+	new_file = open_backing_file(file, filename, &program);
 	fclose(file);
-
-	// Reopen file from backing store in read mode
-	new_file = freopen(filename, "r", new_file);
+	if (!new_file) {
+		printf(GENERIC_ERROR_MSG "%s could not be stored\n", filename);
+		return 0;
+	}
 
 	// Initialize PCB and store into RAM
-	if (myinit(new_file) != 0) {
+	err = myinit(new_file, program, created);
+	release_program(program);
+	if (err != 0) {
+		printf(GENERIC_ERROR_MSG "%s could not be loaded\n", filename);
 		return 0;
 	}
 
 	return 1;
 }
+
+/* ----------------------------------------------------------------------------
+ * @brief Acquires the frames. Must be held while a page table, a frame or the
+ *        RAM is read or modified. The ready queue may be locked while the
+ *        frames are held but not the other way around.
+ * ----------------------------------------------------------------------------
+ */
+void lock_frames() {
+	pthread_mutex_lock(&frame_lock);
+}
+
+/* ----------------------------------------------------------------------------
+ * @brief Releases the frames.
+ * ----------------------------------------------------------------------------
+ */
+void unlock_frames() {
+	pthread_mutex_unlock(&frame_lock);
+}
@@ -7,14 +7,85 @@
  */
 #include "pcb.h"
 
-int count_total_pages(FILE *file);
+/*
+ * Page of a process mapped to a frame
+ */
+#ifndef MEMORYMANAGER_H
+#define MEMORYMANAGER_H
+typedef struct frame_mapping frame_mapping_t;
+struct frame_mapping {
+	pcb_t *pcb;
+	int page_number;
+};
+
+/*
+ * Entry of the frame table. A frame is pinned while a CPU executes its page.
+ * Pages with the same content share a frame and are kept in its mappings.
+ * Frames are hashed by the content of their page until it is overwritten.
+ * A frame no page is mapped to is on one of the free lists.
+ */
+typedef struct frame_owner frame_owner_t;
+struct frame_owner {
+	frame_mapping_t *mappings;
+	int sharers;
+	int mapping_capacity;
+	int pins;
+	int prefetched;
+	unsigned int hash;
+	int hashed;
+	int next_hashed;
+	int free_list;
+	int next_free;
+	int previous_free;
+};
+
+/*
+ * Content of a frame: the lines of a page back to back and the offset of
+ * each line in the text, followed by the end of the last line
+ */
+typedef struct frame frame_t;
+struct frame {
+	char *text;
+	int capacity;
+	int *lines;
+	int line_count;
+};
+#endif
+
+int configure_memory(int frames, int lines, int initial);
+int configure_prefetch(int pages, int percent);
+int init_memory();
+int init_pager();
+int get_ram_size();
+int get_page_size();
+int get_initial_frames();
+int count_total_pages(program_t *program);
 FILE *find_page(int page_number, FILE *file);
-int find_frame(FILE *page);
+long get_page_offset(program_t *program, int page_number);
+int read_page(frame_t *frame, FILE *file, program_t *program, int page_number);
+char *get_frame_line(int frame_number, int offset);
+int find_frame(pcb_t *pcb, int page_number);
 int find_victim(pcb_t *pcb);
-int update_frame(int frame_number, int victim_frame, FILE *page);
+int update_frame(int frame_number,
+                 int victim_frame,
+                 pcb_t *pcb,
+                 int page_number);
 int update_page_table(pcb_t *pcb,
                       int page_number,
                       int frame_number,
                       int victim_frame);
+frame_owner_t *get_frame_owner(int frame_number);
+void release_frame(int frame_number);
+void unmap_frame(int frame_number, pcb_t *pcb, int page_number);
+int is_frame_mapped(int frame_number, pcb_t *pcb);
+void pin_frame(int frame_number);
+int is_frame_pinned(int frame_number);
+void unpin_frame(int frame_number);
 int find_empty_frame();
-int launcher(FILE *file);
+int load_page(pcb_t *pcb, int page_number, int may_evict);
+void fault_around(pcb_t *pcb, int page_number);
+int take_prefetched(int frame_number);
+void read_ahead(pcb_t *pcb, int offset);
+int launcher(FILE *file, char *filename, double created);
+void lock_frames();
+void unlock_frames();
@@ -7,62 +7,142 @@
  */
 
 #include <stdlib.h>
+#include <string.h>
 #include <unistd.h>
 #include <stdio.h>
 #include "kernel.h"
 #include "pcb.h"
 #include "memorymanager.h"
 
+// Process ids are handed out in creation order
+int next_pid = 1;
+
+/*
+ * Freed PCBs are kept on a free list linked through next_process and reused
+ * by the next process. The pool grows by a chunk of PCBs when the list is
+ * empty and is never returned to the system. A PCB keeps its page table,
+ * which grows with the pages of the processes reusing it. Guarded by the
+ * frames since PCBs are created and freed with the frames locked.
+ */
+pcb_t *free_pcbs;
+pcb_pool_stats_t pcb_pool;
+
+/*
+ * Functions specific to pcb.c
+ */
+pcb_t *alloc_pcb();
+
+/* ----------------------------------------------------------------------------
+ * @brief Takes a PCB from the pool, growing it if no PCB is free.
+ * @return pcb_t - A PCB pointer. NULL if memory could not be allocated
+ * ----------------------------------------------------------------------------
+ */
+pcb_t *alloc_pcb() {
+	pcb_t *chunk;
+	int i;
+
+	if (free_pcbs) {
+		pcb_pool.hits++;
+	} else {
+		pcb_pool.misses++;
+		chunk = (pcb_t *) malloc(sizeof(pcb_t) * PCB_POOL_CHUNK);
+		if (!chunk) {
+			return NULL;
+		}
+		for (i = 0; i < PCB_POOL_CHUNK; i++) {
+			chunk[i].page_table = NULL;
+			chunk[i].page_table_capacity = 0;
+			chunk[i].next_process = free_pcbs;
+			free_pcbs = &chunk[i];
+		}
+		pcb_pool.allocated += PCB_POOL_CHUNK;
+		pcb_pool.free += PCB_POOL_CHUNK;
+	}
+
+	chunk = free_pcbs;
+	free_pcbs = chunk->next_process;
+	pcb_pool.free--;
+	return chunk;
+}
+
+/* ----------------------------------------------------------------------------
+ * @brief Copies the counters of the PCB pool.
+ * @param output - stats - The counters
+ * ----------------------------------------------------------------------------
+ */
+void get_pcb_pool_stats(pcb_pool_stats_t *stats) {
+	*stats = pcb_pool;
+}
+
 /* ----------------------------------------------------------------------------
  * @brief Creates a PCB. To maintain compatibility with all other functions
  *        makePCB returns an int and not a pointer. The created PCB is returned
  *        as a reference instead.
- * @param input  - file  A pointer to a file
- *        output - pcb   A NULL pointer that will be overwritten
+ * @param input  - file     A pointer to a file
+ *        input  - program  The compiled file, retained by the PCB
  * @return pcb_t - A PCB pointer
  * ----------------------------------------------------------------------------
  */
-pcb_t *make_pcb(FILE *file) {
+pcb_t *make_pcb(FILE *file, program_t *program) {
 	pcb_t *pcb;
-	int i, frame_number, victim_number;
-	FILE *page[2];
+	int i, frame_number;
 
-	// Check if file pointer is null
-	if (!file) {
+	// Check if file pointer or program is null
+	if (!file || !program) {
 		return NULL;
 	}
 
-	// Allocate memory space for a new PCB
-	pcb = (pcb_t *) malloc(sizeof(pcb_t));
+	// Take a PCB from the pool
+	pcb = alloc_pcb();
 
 	if (pcb) {
 		pcb->pc = file;
-		pcb->pages_max = count_total_pages(file);
+		pcb->program = program;
+		retain_program(program);
+		pcb->pid = __atomic_fetch_add(&next_pid, 1, __ATOMIC_RELAXED);
+		pcb->state = PCB_READY;
+		pcb->next_process = NULL;
+		pcb->previous_process = NULL;
+		memset(&pcb->counters, 0, sizeof(pcb_counters_t));
+		pcb->ready_since = 0.0;
+		pcb->created = 0.0;
+		pcb->next_ready = NULL;
+		pcb->level = 0;
+		pcb->tickets = 0;
+		pcb->io_request = NULL;
+		pcb->ram_slot = -1;
+		pcb->pages_max = count_total_pages(program);
 		pcb->pc_page = 1;
+		pcb->pc_frame = -1;
 		pcb->pc_offset = 0;
+		pcb->read_ahead_page = 0;
 
-		for (i = 0; i < RAM_SIZE; i++) {
-			pcb->page_table[i] = 0;
+		// The page table maps each page to its frame, -1 if it is not in
+		// RAM. The initial frames are loaded even past the last page
+		pcb->page_table_size = pcb->pages_max > get_initial_frames() ?
+		                       pcb->pages_max : get_initial_frames();
+		if (reserve((void **) &pcb->page_table, &pcb->page_table_capacity,
+		            pcb->page_table_size, sizeof(int)) != 0) {
+			pcb->page_table_size = 0;
+			free_pcb(pcb);
+			return NULL;
+		}
+		for (i = 0; i < pcb->page_table_size; i++) {
+			pcb->page_table[i] = -1;
 		}
 
-		// Load 2 frames into RAM
-		for (i = 0; i < INITIAL_FRAME_NUMBER; i++) {
-			// Duplicate opened file
-			page[i] = fdopen(dup(fileno(pcb->pc)), "r");
-			page[i] = find_page(i + 1, page[i]);
-			frame_number = find_empty_frame();
+		// Load the initial frames into RAM, taking the place of a victim if
+		// no frame is empty
+		for (i = 0; i < get_initial_frames(); i++) {
+			frame_number = load_page(pcb, i + 1, 1);
 			if (frame_number == -1) {
-				// Select a victim and take its place in memory
-				victim_number = find_victim(pcb);
-				update_frame(frame_number, victim_number, page[i]);
-				update_victim_page_table(frame_number, victim_number);
-				update_page_table(pcb, i + 1, frame_number, victim_number);
-			} else {
-				// No victim needed
-				update_frame(frame_number, -1, page[i]);
-				update_page_table(pcb, i + 1, frame_number, -1);
+				// Every frame is executing or the page cannot be read
+				free_pcb(pcb);
+				return NULL;
+			}
+			if (i == 0) {
+				pcb->pc_frame = frame_number;
 			}
-			fseek(pcb->pc, 0, SEEK_SET);
 		}
 
 		return pcb;
@@ -72,19 +152,26 @@ pcb_t *make_pcb(FILE *file) {
 }
 
 /* ----------------------------------------------------------------------------
- * @brief Frees up a PCB and all of its resources.
+ * @brief Frees up a PCB and all of its resources. The frames must be locked.
+ *        The process id is cleared so that a read-ahead request for the
+ *        process is dropped.
  * @param input  - pcb  A PCB to be freed.
  * ----------------------------------------------------------------------------
  */
 void free_pcb(pcb_t *pcb) {
 	int i = 0;
 
-	for (i = 0; i < RAM_SIZE; i++) {
-		if (pcb->page_table[i] != 0) {
-			fclose(ram[i]);
-			ram[i] = NULL;
+	for (i = 0; i < pcb->page_table_size; i++) {
+		if (pcb->page_table[i] != -1) {
+			unmap_frame(pcb->page_table[i], pcb, i + 1);
 		}
 	}
 
-	free(pcb);
+	release_program(pcb->program);
+	pcb->pid = 0;
+
+	// Return the PCB to the pool
+	pcb->next_process = free_pcbs;
+	free_pcbs = pcb;
+	pcb_pool.free++;
 }
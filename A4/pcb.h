@@ -6,24 +6,66 @@
  * ----------------------------------------------------------------------------
  */
 #include "constant.h"
+#include "program.h"
 
 /*
- * PCB structure
+ * PCB structure. The counters are plain increments done by the kernel, the
+ * CPU and the I/O scheduler while the process runs.
  */
 #ifndef PCB_H
 #define PCB_H
+typedef struct pcb_counters pcb_counters_t;
+struct pcb_counters {
+	unsigned long lines;
+	unsigned long quanta;
+	unsigned long page_faults;
+	unsigned long evictions;
+	unsigned long blocks_read;
+	unsigned long blocks_written;
+	double ready_time;
+};
+
 typedef struct pcb pcb_t;
 struct pcb {
 	FILE *pc;
-	int page_table[RAM_SIZE];
+	program_t *program;
+	int pid;
+	int state;
+	pcb_t *next_process;
+	pcb_t *previous_process;
+	pcb_counters_t counters;
+	double ready_since;
+	double created;
+	pcb_t *next_ready;
+	int level;
+	int tickets;
+	struct io_request *io_request;
+	int ram_slot;
+	int *page_table;
+	int page_table_size;
+	int page_table_capacity;
 	int pc_page;
+	int pc_frame;
 	int pc_offset;
 	int pages_max;
+	int read_ahead_page;
+};
+
+/*
+ * PCB pool counters. A hit reuses a freed PCB, a miss grows the pool.
+ */
+typedef struct pcb_pool_stats pcb_pool_stats_t;
+struct pcb_pool_stats {
+	unsigned long allocated;
+	unsigned long free;
+	unsigned long hits;
+	unsigned long misses;
 };
 #endif
 
 /*
  * PCB interfaces
  */
-pcb_t *make_pcb(FILE *file);
+pcb_t *make_pcb(FILE *file, program_t *program);
 void free_pcb(pcb_t *pcb);
+void get_pcb_pool_stats(pcb_pool_stats_t *stats);
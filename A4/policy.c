@@ -0,0 +1,725 @@
+/* ----------------------------------------------------------------------------
+ * @file POLICY.C
+ * @author Si Xun Li - 260674916
+ * @version 1.0
+ * @brief This file contains the scheduling policies:
+ *            - rr      - Round robin. New processes go on the lock-free ready
+ *                        queue and preempted ones on the run queue of their
+ *                        CPU, with idle CPUs stealing from the others.
+ *            - mlfq    - Multi-level feedback queue. A process using its whole
+ *                        quantum moves down a level, where quanta are twice
+ *                        as long. Every process is moved back to the top
+ *                        level periodically so that none starves.
+ *            - sjf     - Shortest job first, the job being the number of
+ *                        pages of the script.
+ *            - lottery - Each process holds tickets and a random ticket picks
+ *                        the next process. A process stopped by a page fault
+ *                        before the end of its quantum is compensated with
+ *                        more tickets for its next draw.
+ *        Only round robin keeps processes on their CPU. The other policies
+ *        order every ready process so they share a single lock.
+ * ----------------------------------------------------------------------------
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "constant.h"
+#include "kernel.h"
+#include "policy.h"
+#include "ready_queue.h"
+
+/*
+ * Policy functions
+ */
+int rr_configure(int *args, int num_of_args);
+void rr_describe();
+int rr_admit(pcb_t *pcb);
+int rr_preempt(int cpu_id, pcb_t *pcb, int lines_run);
+pcb_t *rr_next(int cpu_id);
+int rr_has_ready();
+int rr_quantum(pcb_t *pcb);
+int mlfq_configure(int *args, int num_of_args);
+void mlfq_describe();
+int mlfq_admit(pcb_t *pcb);
+int mlfq_preempt(int cpu_id, pcb_t *pcb, int lines_run);
+pcb_t *mlfq_next(int cpu_id);
+int mlfq_quantum(pcb_t *pcb);
+int sjf_configure(int *args, int num_of_args);
+void sjf_describe();
+int sjf_admit(pcb_t *pcb);
+int sjf_preempt(int cpu_id, pcb_t *pcb, int lines_run);
+pcb_t *sjf_next(int cpu_id);
+int lottery_configure(int *args, int num_of_args);
+void lottery_describe();
+int lottery_admit(pcb_t *pcb);
+int lottery_preempt(int cpu_id, pcb_t *pcb, int lines_run);
+pcb_t *lottery_next(int cpu_id);
+int shared_has_ready();
+int shared_quantum(pcb_t *pcb);
+int sjf_before(pcb_t *a, pcb_t *b);
+int grow_pool(int needed);
+
+policy_t policies[] = {
+	{"rr", "rr [<quantum>]", rr_configure, rr_describe, rr_admit,
+	 rr_preempt, rr_next, rr_has_ready, rr_quantum},
+	{"mlfq", "mlfq [<quantum>] [<levels>] [<boost_interval>]",
+	 mlfq_configure, mlfq_describe, mlfq_admit, mlfq_preempt, mlfq_next,
+	 shared_has_ready, mlfq_quantum},
+	{"sjf", "sjf [<quantum>]", sjf_configure, sjf_describe, sjf_admit,
+	 sjf_preempt, sjf_next, shared_has_ready, shared_quantum},
+	{"lottery", "lottery [<quantum>] [<tickets>]", lottery_configure,
+	 lottery_describe, lottery_admit, lottery_preempt, lottery_next,
+	 shared_has_ready, shared_quantum}
+};
+const int POLICY_COUNT = sizeof(policies) / sizeof(policy_t);
+
+policy_t *policy = &policies[0];
+
+// Quanta given to a process each time it is dispatched, and when a policy is
+// selected without a quantum
+int quantum = DEFAULT_QUANTA;
+int default_quantum = DEFAULT_QUANTA;
+
+/*
+ * Round robin queues
+ */
+ready_queue_t *ready_ring;
+cpu_queue_t run_queues[MAX_CPUS];
+
+/*
+ * Processes of the other policies, guarded by shared_lock. MLFQ keeps a list
+ * per level linked through the PCBs. SJF keeps a binary heap and lottery an
+ * unordered pool, both in the pool array.
+ */
+pthread_mutex_t shared_lock = PTHREAD_MUTEX_INITIALIZER;
+int shared_count = 0;
+
+pcb_t *levels_first[MLFQ_MAX_LEVELS];
+pcb_t *levels_last[MLFQ_MAX_LEVELS];
+int mlfq_levels = MLFQ_LEVELS;
+int mlfq_boost = MLFQ_BOOST_INTERVAL;
+int mlfq_dispatches = 0;
+
+pcb_t **pool;
+int pool_capacity = 0;
+
+int lottery_tickets = LOTTERY_TICKETS;
+unsigned long total_tickets = 0;
+unsigned int lottery_seed = 1;
+
+/* ----------------------------------------------------------------------------
+ * @brief Creates the queues of the policies. Round robin is selected.
+ * @return int - Status code
+ *                  0 - No errors
+ *                 -1 - Memory could not be allocated
+ * ----------------------------------------------------------------------------
+ */
+int init_policies() {
+	int i;
+
+	ready_ring = create_ready_queue(READY_QUEUE_CAPACITY);
+	if (!ready_ring) {
+		return -1;
+	}
+	for (i = 0; i < MAX_CPUS; i++) {
+		if (init_cpu_queue(&run_queues[i]) != 0) {
+			return -1;
+		}
+	}
+	return 0;
+}
+
+/* ----------------------------------------------------------------------------
+ * @brief Finds a policy by name.
+ * @param input  - name - The name of the policy
+ * @return The policy. NULL if no policy has this name
+ * ----------------------------------------------------------------------------
+ */
+policy_t *find_policy(char *name) {
+	int i;
+
+	for (i = 0; i < POLICY_COUNT; i++) {
+		if (strcmp(policies[i].name, name) == 0) {
+			return &policies[i];
+		}
+	}
+	return NULL;
+}
+
+/* ----------------------------------------------------------------------------
+ * @brief Returns the selected policy.
+ * ----------------------------------------------------------------------------
+ */
+policy_t *get_policy() {
+	return policy;
+}
+
+/* ----------------------------------------------------------------------------
+ * @brief Selects a policy. No process may be queued, which holds whenever the
+ *        scheduler is not running.
+ * @param input  - new_policy  - The policy to select
+ *        input  - args        - Numeric arguments of the policy
+ *        input  - num_of_args - Number of arguments
+ * @return int - Status code
+ *                  0 - No errors
+ *                 -1 - Invalid arguments
+ *                 -2 - Processes are queued
+ * ----------------------------------------------------------------------------
+ */
+int set_policy(policy_t *new_policy, int *args, int num_of_args) {
+	if (policy->has_ready()) {
+		return -2;
+	}
+	if (new_policy->configure(args, num_of_args) != 0) {
+		return -1;
+	}
+	policy = new_policy;
+	return 0;
+}
+
+/* ----------------------------------------------------------------------------
+ * @brief Sets the quantum used when a policy is selected without one. The
+ *        current policy switches to it.
+ * @param input  - quanta - Lines a process may run per dispatch
+ * @return int - Status code
+ *                  0 - No errors
+ *                 -1 - The quantum is not positive
+ * ----------------------------------------------------------------------------
+ */
+int set_default_quantum(int quanta) {
+	if (quanta < 1) {
+		return -1;
+	}
+	default_quantum = quanta;
+	quantum = quanta;
+	return 0;
+}
+
+/* ----------------------------------------------------------------------------
+ * @brief Prints the usage of every policy.
+ * ----------------------------------------------------------------------------
+ */
+void print_policies() {
+	int i;
+
+	for (i = 0; i < POLICY_COUNT; i++) {
+		printf(TAB "sched %s\n", policies[i].usage);
+	}
+}
+
+/* ----------------------------------------------------------------------------
+ * @brief Reads the quantum, the first argument of every policy.
+ * @return int - Status code
+ *                  0 - No errors
+ *                 -1 - The quantum is not positive
+ * ----------------------------------------------------------------------------
+ */
+int configure_quantum(int *args, int num_of_args) {
+	if (num_of_args >= 1) {
+		if (args[0] < 1) {
+			return -1;
+		}
+		quantum = args[0];
+	} else {
+		quantum = default_quantum;
+	}
+	return 0;
+}
+
+/* ----------------------------------------------------------------------------
+ * @brief Configures round robin.
+ * @return int - Status code
+ *                  0 - No errors
+ *                 -1 - Invalid arguments
+ * ----------------------------------------------------------------------------
+ */
+int rr_configure(int *args, int num_of_args) {
+	if (num_of_args > 1) {
+		return -1;
+	}
+	return configure_quantum(args, num_of_args);
+}
+
+void rr_describe() {
+	printf("rr (quantum %d)\n", quantum);
+}
+
+/* ----------------------------------------------------------------------------
+ * @brief Puts a new process on the ready queue.
+ * @return int - Status code
+ *                  0 - No errors
+ *                 -1 - The ready queue is full
+ * ----------------------------------------------------------------------------
+ */
+int rr_admit(pcb_t *pcb) {
+	return enqueue_ready(ready_ring, pcb);
+}
+
+/* ----------------------------------------------------------------------------
+ * @brief Puts a preempted process at the tail of the run queue of its CPU.
+ * @return int - Status code
+ *                  1 - Another CPU may take the process
+ *                  0 - Only its CPU will take the process
+ *                 -1 - Memory could not be allocated
+ * ----------------------------------------------------------------------------
+ */
+int rr_preempt(int cpu_id, pcb_t *pcb, int lines_run) {
+	if (push_cpu_queue(&run_queues[cpu_id], pcb) != 0) {
+		return -1;
+	}
+	// A second process can be stolen by an idle CPU
+	return cpu_queue_size(&run_queues[cpu_id]) >= 2;
+}
+
+/* ----------------------------------------------------------------------------
+ * @brief Selects the next process of a CPU. New processes on the ready queue
+ *        come first so that they start promptly, then the run queue of the
+ *        CPU, then the tail of the run queues of the other CPUs. The search
+ *        starts after the CPU so that thieves spread over victims.
+ * @return A PCB. NULL if no process is ready
+ * ----------------------------------------------------------------------------
+ */
+pcb_t *rr_next(int cpu_id) {
+	pcb_t *pcb;
+	int i;
+
+	pcb = dequeue_ready(ready_ring);
+	if (!pcb) {
+		pcb = pop_cpu_queue(&run_queues[cpu_id]);
+	}
+	for (i = 1; !pcb && i < MAX_CPUS; i++) {
+		pcb = steal_cpu_queue(&run_queues[(cpu_id + i) % MAX_CPUS]);
+		if (pcb) {
+			__atomic_add_fetch(&counters.steals, 1, __ATOMIC_RELAXED);
+		}
+	}
+	return pcb;
+}
+
+/* ----------------------------------------------------------------------------
+ * @brief Checks if an idle CPU could take a process, either from the ready
+ *        queue or by stealing.
+ * @return int - 1 if a process may be available, 0 otherwise
+ * ----------------------------------------------------------------------------
+ */
+int rr_has_ready() {
+	int i;
+
+	if (!is_ready_queue_empty(ready_ring)) {
+		return 1;
+	}
+	for (i = 0; i < MAX_CPUS; i++) {
+		if (cpu_queue_size(&run_queues[i]) >= 2) {
+			return 1;
+		}
+	}
+	return 0;
+}
+
+int rr_quantum(pcb_t *pcb) {
+	return quantum;
+}
+
+/* ----------------------------------------------------------------------------
+ * @brief Checks if a process is queued by one of the shared policies.
+ * ----------------------------------------------------------------------------
+ */
+int shared_has_ready() {
+	return __atomic_load_n(&shared_count, __ATOMIC_SEQ_CST) > 0;
+}
+
+int shared_quantum(pcb_t *pcb) {
+	return quantum;
+}
+
+/* ----------------------------------------------------------------------------
+ * @brief Makes room for a number of processes in the pool.
+ * @return int - Status code
+ *                  0 - No errors
+ *                 -1 - Memory could not be allocated
+ * ----------------------------------------------------------------------------
+ */
+int grow_pool(int needed) {
+	pcb_t **grown;
+	int capacity;
+
+	if (needed <= pool_capacity) {
+		return 0;
+	}
+	capacity = pool_capacity ? pool_capacity * 2 : CPU_QUEUE_INITIAL_CAPACITY;
+	while (capacity < needed) {
+		capacity *= 2;
+	}
+	grown = (pcb_t **) realloc(pool, sizeof(pcb_t *) * capacity);
+	if (!grown) {
+		return -1;
+	}
+	pool = grown;
+	pool_capacity = capacity;
+	return 0;
+}
+
+/* ----------------------------------------------------------------------------
+ * @brief Configures the multi-level feedback queue.
+ *            args[0] - Quantum of the top level
+ *            args[1] - Number of levels
+ *            args[2] - Dispatches between two boosts to the top level
+ * @return int - Status code
+ *                  0 - No errors
+ *                 -1 - Invalid arguments
+ * ----------------------------------------------------------------------------
+ */
+int mlfq_configure(int *args, int num_of_args) {
+	if (num_of_args > 3 || configure_quantum(args, num_of_args) != 0) {
+		return -1;
+	}
+	if (num_of_args >= 2 && (args[1] < 1 || args[1] > MLFQ_MAX_LEVELS)) {
+		return -1;
+	}
+	if (num_of_args >= 3 && args[2] < 1) {
+		return -1;
+	}
+	mlfq_levels = num_of_args >= 2 ? args[1] : MLFQ_LEVELS;
+	mlfq_boost = num_of_args >= 3 ? args[2] : MLFQ_BOOST_INTERVAL;
+	mlfq_dispatches = 0;
+	return 0;
+}
+
+void mlfq_describe() {
+	printf("mlfq (quantum %d, %d levels, boost every %d dispatches)\n",
+	       quantum, mlfq_levels, mlfq_boost);
+}
+
+/* ----------------------------------------------------------------------------
+ * @brief Adds a process at the tail of its level. The lock must be held.
+ * ----------------------------------------------------------------------------
+ */
+void mlfq_append(pcb_t *pcb) {
+	pcb->next_ready = NULL;
+	if (levels_last[pcb->level]) {
+		levels_last[pcb->level]->next_ready = pcb;
+	} else {
+		levels_first[pcb->level] = pcb;
+	}
+	levels_last[pcb->level] = pcb;
+	__atomic_store_n(&shared_count, shared_count + 1, __ATOMIC_SEQ_CST);
+}
+
+/* ----------------------------------------------------------------------------
+ * @brief Puts a new process at the top level.
+ * @return int - Status code
+ *                  0 - No errors
+ * ----------------------------------------------------------------------------
+ */
+int mlfq_admit(pcb_t *pcb) {
+	pthread_mutex_lock(&shared_lock);
+	pcb->level = 0;
+	mlfq_append(pcb);
+	pthread_mutex_unlock(&shared_lock);
+	return 0;
+}
+
+/* ----------------------------------------------------------------------------
+ * @brief Puts a preempted process back. It moves down a level if it used its
+ *        whole quantum.
+ * @return int - Status code
+ *                  1 - Another CPU may take the process
+ * ----------------------------------------------------------------------------
+ */
+int mlfq_preempt(int cpu_id, pcb_t *pcb, int lines_run) {
+	pthread_mutex_lock(&shared_lock);
+	if (lines_run >= mlfq_quantum(pcb) && pcb->level < mlfq_levels - 1) {
+		pcb->level++;
+	}
+	mlfq_append(pcb);
+	pthread_mutex_unlock(&shared_lock);
+	return 1;
+}
+
+/* ----------------------------------------------------------------------------
+ * @brief Takes the first process of the highest non-empty level. Every
+ *        process is moved to the top level once in a while.
+ * @return A PCB. NULL if no process is ready
+ * ----------------------------------------------------------------------------
+ */
+pcb_t *mlfq_next(int cpu_id) {
+	pcb_t *pcb = NULL;
+	int i;
+
+	if (!shared_has_ready()) {
+		return NULL;
+	}
+
+	pthread_mutex_lock(&shared_lock);
+	if (++mlfq_dispatches >= mlfq_boost) {
+		mlfq_dispatches = 0;
+		for (i = 1; i < MLFQ_MAX_LEVELS; i++) {
+			for (pcb = levels_first[i]; pcb; pcb = pcb->next_ready) {
+				pcb->level = 0;
+			}
+			if (levels_first[i]) {
+				if (levels_last[0]) {
+					levels_last[0]->next_ready = levels_first[i];
+				} else {
+					levels_first[0] = levels_first[i];
+				}
+				levels_last[0] = levels_last[i];
+				levels_first[i] = NULL;
+				levels_last[i] = NULL;
+			}
+		}
+	}
+
+	pcb = NULL;
+	for (i = 0; i < MLFQ_MAX_LEVELS && !pcb; i++) {
+		pcb = levels_first[i];
+		if (pcb) {
+			levels_first[i] = pcb->next_ready;
+			if (!levels_first[i]) {
+				levels_last[i] = NULL;
+			}
+			pcb->next_ready = NULL;
+			__atomic_store_n(&shared_count, shared_count - 1,
+			                 __ATOMIC_SEQ_CST);
+		}
+	}
+	pthread_mutex_unlock(&shared_lock);
+	return pcb;
+}
+
+/* ----------------------------------------------------------------------------
+ * @brief Returns the quantum of the level of a process, doubled at each level.
+ * ----------------------------------------------------------------------------
+ */
+int mlfq_quantum(pcb_t *pcb) {
+	return quantum << pcb->level;
+}
+
+/* ----------------------------------------------------------------------------
+ * @brief Configures shortest job first.
+ * @return int - Status code
+ *                  0 - No errors
+ *                 -1 - Invalid arguments
+ * ----------------------------------------------------------------------------
+ */
+int sjf_configure(int *args, int num_of_args) {
+	if (num_of_args > 1) {
+		return -1;
+	}
+	return configure_quantum(args, num_of_args);
+}
+
+void sjf_describe() {
+	printf("sjf (quantum %d)\n", quantum);
+}
+
+/* ----------------------------------------------------------------------------
+ * @brief Orders two processes for shortest job first. Ties go to the oldest
+ *        process.
+ * @return int - 1 if a runs before b, 0 otherwise
+ * ----------------------------------------------------------------------------
+ */
+int sjf_before(pcb_t *a, pcb_t *b) {
+	if (a->pages_max != b->pages_max) {
+		return a->pages_max < b->pages_max;
+	}
+	return a->pid < b->pid;
+}
+
+/* ----------------------------------------------------------------------------
+ * @brief Adds a process to the heap.
+ * @return int - Status code
+ *                  0 - No errors
+ *                 -1 - Memory could not be allocated
+ * ----------------------------------------------------------------------------
+ */
+int sjf_admit(pcb_t *pcb) {
+	int i, parent;
+
+	pthread_mutex_lock(&shared_lock);
+	if (grow_pool(shared_count + 1) != 0) {
+		pthread_mutex_unlock(&shared_lock);
+		return -1;
+	}
+	// Sift the process up from the end of the heap
+	i = shared_count;
+	while (i > 0) {
+		parent = (i - 1) / 2;
+		if (!sjf_before(pcb, pool[parent])) {
+			break;
+		}
+		pool[i] = pool[parent];
+		i = parent;
+	}
+	pool[i] = pcb;
+	__atomic_store_n(&shared_count, shared_count + 1, __ATOMIC_SEQ_CST);
+	pthread_mutex_unlock(&shared_lock);
+	return 0;
+}
+
+int sjf_preempt(int cpu_id, pcb_t *pcb, int lines_run) {
+	return sjf_admit(pcb) == 0 ? 1 : -1;
+}
+
+/* ----------------------------------------------------------------------------
+ * @brief Takes the shortest process from the heap.
+ * @return A PCB. NULL if no process is ready
+ * ----------------------------------------------------------------------------
+ */
+pcb_t *sjf_next(int cpu_id) {
+	pcb_t *pcb, *last;
+	int i, child, count;
+
+	if (!shared_has_ready()) {
+		return NULL;
+	}
+
+	pthread_mutex_lock(&shared_lock);
+	if (shared_count == 0) {
+		pthread_mutex_unlock(&shared_lock);
+		return NULL;
+	}
+	pcb = pool[0];
+	count = shared_count - 1;
+	last = pool[count];
+	// Sift the last process down from the root
+	i = 0;
+	while ((child = 2 * i + 1) < count) {
+		if (child + 1 < count && sjf_before(pool[child + 1], pool[child])) {
+			child++;
+		}
+		if (!sjf_before(pool[child], last)) {
+			break;
+		}
+		pool[i] = pool[child];
+		i = child;
+	}
+	pool[i] = last;
+	__atomic_store_n(&shared_count, count, __ATOMIC_SEQ_CST);
+	pthread_mutex_unlock(&shared_lock);
+	return pcb;
+}
+
+/* ----------------------------------------------------------------------------
+ * @brief Configures lottery scheduling.
+ *            args[0] - Quantum
+ *            args[1] - Tickets given to each process
+ * @return int - Status code
+ *                  0 - No errors
+ *                 -1 - Invalid arguments
+ * ----------------------------------------------------------------------------
+ */
+int lottery_configure(int *args, int num_of_args) {
+	// Bounded so that compensated tickets cannot overflow
+	if (num_of_args > 2 ||
+	    (num_of_args >= 1 && args[0] > LOTTERY_MAX_QUANTUM) ||
+	    (num_of_args == 2 && (args[1] < 1 ||
+	                          args[1] > LOTTERY_MAX_TICKETS)) ||
+	    configure_quantum(args, num_of_args) != 0) {
+		return -1;
+	}
+	lottery_tickets = num_of_args == 2 ? args[1] : LOTTERY_TICKETS;
+	return 0;
+}
+
+void lottery_describe() {
+	printf("lottery (quantum %d, %d tickets)\n", quantum, lottery_tickets);
+}
+
+/* ----------------------------------------------------------------------------
+ * @brief Adds a process and its tickets to the pool. The lock must be held.
+ * @return int - Status code
+ *                  0 - No errors
+ *                 -1 - Memory could not be allocated
+ * ----------------------------------------------------------------------------
+ */
+int lottery_add(pcb_t *pcb) {
+	if (grow_pool(shared_count + 1) != 0) {
+		return -1;
+	}
+	pool[shared_count] = pcb;
+	total_tickets += pcb->tickets;
+	__atomic_store_n(&shared_count, shared_count + 1, __ATOMIC_SEQ_CST);
+	return 0;
+}
+
+int lottery_admit(pcb_t *pcb) {
+	int err;
+
+	pthread_mutex_lock(&shared_lock);
+	pcb->tickets = lottery_tickets;
+	err = lottery_add(pcb);
+	pthread_mutex_unlock(&shared_lock);
+	return err;
+}
+
+/* ----------------------------------------------------------------------------
+ * @brief Puts a preempted process back in the pool. A process that ran for a
+ *        fraction of its quantum holds its tickets divided by that fraction,
+ *        up to LOTTERY_MAX_HELD, until it is drawn.
+ * @return int - Status code
+ *                  1 - Another CPU may take the process
+ *                 -1 - Memory could not be allocated
+ * ----------------------------------------------------------------------------
+ */
+int lottery_preempt(int cpu_id, pcb_t *pcb, int lines_run) {
+	unsigned long tickets;
+	int err;
+
+	pthread_mutex_lock(&shared_lock);
+	if (lines_run < 1) {
+		lines_run = 1;
+	}
+	tickets = lottery_tickets;
+	if (lines_run < quantum) {
+		tickets = tickets * quantum / lines_run;
+	}
+	pcb->tickets = tickets < LOTTERY_MAX_HELD ? (int) tickets :
+	               LOTTERY_MAX_HELD;
+	err = lottery_add(pcb);
+	pthread_mutex_unlock(&shared_lock);
+	return err == 0 ? 1 : -1;
+}
+
+/* ----------------------------------------------------------------------------
+ * @brief Draws a ticket and takes the process holding it. A process is drawn
+ *        uniformly if no process holds a ticket.
+ * @return A PCB. NULL if no process is ready
+ * ----------------------------------------------------------------------------
+ */
+pcb_t *lottery_next(int cpu_id) {
+	pcb_t *pcb;
+	unsigned long ticket;
+	int i;
+
+	if (!shared_has_ready()) {
+		return NULL;
+	}
+
+	pthread_mutex_lock(&shared_lock);
+	if (shared_count == 0) {
+		pthread_mutex_unlock(&shared_lock);
+		return NULL;
+	}
+	ticket = (unsigned long) rand_r(&lottery_seed) * (RAND_MAX + 1UL) +
+	         rand_r(&lottery_seed);
+	if (total_tickets == 0) {
+		i = (int) (ticket % shared_count);
+	} else {
+		ticket = ticket % total_tickets;
+		for (i = 0; i < shared_count - 1; i++) {
+			if (ticket < (unsigned long) pool[i]->tickets) {
+				break;
+			}
+			ticket -= pool[i]->tickets;
+		}
+	}
+	pcb = pool[i];
+	total_tickets -= pcb->tickets;
+	pool[i] = pool[shared_count - 1];
+	__atomic_store_n(&shared_count, shared_count - 1, __ATOMIC_SEQ_CST);
+	pthread_mutex_unlock(&shared_lock);
+	return pcb;
+}
@@ -0,0 +1,40 @@
+/* ----------------------------------------------------------------------------
+ * @file POLICY.H
+ * @author Si Xun Li - 260674916
+ * @version 1.0
+ * @brief This file is the header file for the scheduling policies.
+ * ----------------------------------------------------------------------------
+ */
+
+#include "pcb.h"
+
+/*
+ * Scheduling policy. The kernel admits new processes, puts preempted ones
+ * back and asks for the next process of a CPU through these functions. Every
+ * function may be called by several CPUs at once.
+ */
+#ifndef POLICY_H
+#define POLICY_H
+typedef struct policy policy_t;
+struct policy {
+	char *name;
+	char *usage;
+	int (*configure)(int *args, int num_of_args);
+	void (*describe)();
+	int (*admit)(pcb_t *pcb);
+	int (*preempt)(int cpu_id, pcb_t *pcb, int lines_run);
+	pcb_t *(*next)(int cpu_id);
+	int (*has_ready)();
+	int (*quantum)(pcb_t *pcb);
+};
+#endif
+
+/*
+ * Available functions for the scheduling policies
+ */
+int init_policies();
+policy_t *find_policy(char *name);
+policy_t *get_policy();
+int set_policy(policy_t *policy, int *args, int num_of_args);
+int set_default_quantum(int quanta);
+void print_policies();
@@ -0,0 +1,611 @@
+/* ----------------------------------------------------------------------------
+ * @file PROGRAM.C
+ * @author Si Xun Li - 260674916
+ * @version 1.0
+ * @brief This file compiles scripts into instructions and caches them by
+ *        filename. A cached program is reused for as long as its source file
+ *        is unchanged, so a script is only parsed again after it is modified.
+ * ----------------------------------------------------------------------------
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include "constant.h"
+#include "program.h"
+#include "command.h"
+
+/*
+ * Compiled programs hashed by filename
+ */
+program_t *program_cache[PROGRAM_CACHE_BUCKETS];
+pthread_mutex_t cache_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/*
+ * Header of the index of a program kept in the backing store, followed by its
+ * instructions and its words. Opcodes are resolved again when the index is
+ * loaded since they depend on the order commands are registered in.
+ */
+typedef struct program_index program_index_t;
+struct program_index {
+	unsigned int magic;
+	unsigned int version;
+	unsigned long long content_hash;
+	int text_size;
+	int line_count;
+	int word_count;
+	int max_line_length;
+	int max_words;
+};
+
+/*
+ * Private functions
+ */
+unsigned int hash_filename(char *filename);
+int same_source(struct stat *a, struct stat *b);
+void free_program(program_t *program);
+void resolve_opcode(program_t *program, instruction_t *instruction);
+int check_program_index(program_t *program);
+
+/* ----------------------------------------------------------------------------
+ * @brief Hashes a filename using FNV-1a.
+ * @param input  - filename - A null-terminated string
+ * @return The bucket of the filename in the cache
+ * ----------------------------------------------------------------------------
+ */
+unsigned int hash_filename(char *filename) {
+	unsigned int hash = 2166136261u;
+	while (*filename) {
+		hash ^= (unsigned char) *filename++;
+		hash *= 16777619u;
+	}
+	return hash % PROGRAM_CACHE_BUCKETS;
+}
+
+/* ----------------------------------------------------------------------------
+ * @brief Checks if two stats describe the same unmodified file.
+ * @return 1 if the file is the same, 0 otherwise
+ * ----------------------------------------------------------------------------
+ */
+int same_source(struct stat *a, struct stat *b) {
+	return a->st_dev == b->st_dev &&
+	       a->st_ino == b->st_ino &&
+	       a->st_size == b->st_size &&
+	       a->st_mtim.tv_sec == b->st_mtim.tv_sec &&
+	       a->st_mtim.tv_nsec == b->st_mtim.tv_nsec;
+}
+
+/* ----------------------------------------------------------------------------
+ * @brief Grows an array so that it can hold a number of elements.
+ * @param input  - array        - The array to grow
+ *        input  - capacity     - The number of elements the array can hold
+ *        input  - needed       - The number of elements required
+ *        input  - element_size - The size of an element
+ * @return int - Status code
+ *                  0 - No errors
+ *                 -1 - Could not allocate new memory space
+ * ----------------------------------------------------------------------------
+ */
+int reserve(void **array, int *capacity, int needed, size_t element_size) {
+	int new_capacity;
+	void *new_array;
+
+	if (needed <= *capacity) {
+		return 0;
+	}
+
+	new_capacity = *capacity ? *capacity : 16;
+	while (new_capacity < needed) {
+		new_capacity = new_capacity << 1;
+	}
+
+	new_array = realloc(*array, new_capacity * element_size);
+	if (!new_array) {
+		return -1;
+	}
+	*array = new_array;
+	*capacity = new_capacity;
+	return 0;
+}
+
+/* ----------------------------------------------------------------------------
+ * @brief Finds the compiled program of a file. Programs whose source was
+ *        modified since they were compiled are evicted from the cache.
+ * @param input  - filename - The path of the script
+ * @return A retained program. NULL if the file is not cached or was modified
+ * ----------------------------------------------------------------------------
+ */
+program_t *find_program(char *filename) {
+	struct stat source;
+	program_t **link, *program;
+
+	if (!filename || stat(filename, &source) != 0) {
+		return NULL;
+	}
+
+	pthread_mutex_lock(&cache_lock);
+	link = &program_cache[hash_filename(filename)];
+	for (program = *link; program; program = *link) {
+		if (strcmp(program->filename, filename) == 0) {
+			if (same_source(&program->source, &source)) {
+				retain_program(program);
+			} else {
+				// Stale, drop the reference held by the cache
+				*link = program->next;
+				program->next = NULL;
+				release_program(program);
+				program = NULL;
+			}
+			break;
+		}
+		link = &program->next;
+	}
+	pthread_mutex_unlock(&cache_lock);
+	return program;
+}
+
+/* ----------------------------------------------------------------------------
+ * @brief Creates an empty program for a file. Lines are added with
+ *        compile_line and the program is shared with cache_program.
+ * @param input  - filename - The path of the script
+ * @return A program with a single reference. NULL if the file does not exist
+ *         or memory could not be allocated
+ * ----------------------------------------------------------------------------
+ */
+program_t *create_program(char *filename) {
+	program_t *program;
+
+	if (!filename) {
+		return NULL;
+	}
+
+	program = (program_t *) calloc(1, sizeof(program_t));
+	if (!program) {
+		return NULL;
+	}
+
+	program->filename = strdup(filename);
+	if (!program->filename || stat(filename, &program->source) != 0) {
+		free(program->filename);
+		free(program);
+		return NULL;
+	}
+	program->references = 1;
+	return program;
+}
+
+/* ----------------------------------------------------------------------------
+ * @brief Appends a line to a program. The command is resolved and the words
+ *        are located with the same rules as tokenize.
+ * @param input  - program - A program being compiled
+ *        input  - line    - A line as read by fgets
+ * @return int - Status code
+ *                  0 - No errors
+ *                 -1 - Program or line is null
+ *                 -2 - Could not allocate new memory space
+ * ----------------------------------------------------------------------------
+ */
+int compile_line(program_t *program, char *line) {
+	int i, length, start;
+	instruction_t *instruction;
+	word_t *word;
+
+	if (!program || !line) {
+		return -1;
+	}
+
+	length = strlen(line);
+	if (reserve((void **) &program->text, &program->text_capacity,
+	            program->text_size + length, sizeof(char)) != 0 ||
+	    reserve((void **) &program->code, &program->code_capacity,
+	            program->line_count + 1, sizeof(instruction_t)) != 0) {
+		return -2;
+	}
+
+	instruction = &program->code[program->line_count];
+	instruction->line_offset = program->text_size;
+	instruction->line_length = length;
+	instruction->first_word = program->word_count;
+	instruction->word_count = 0;
+	memcpy(program->text + program->text_size, line, length);
+
+	// Locate the words within the line
+	i = 0;
+	while (i < length && instruction->word_count < MAX_WORDS) {
+		while (line[i] == ' ' || line[i] == '\n') {
+			i++;
+		}
+		if (i >= length) {
+			break;
+		}
+		start = i;
+		while (i < length && line[i] != ' ' && line[i] != '\n') {
+			i++;
+		}
+
+		if (reserve((void **) &program->words, &program->word_capacity,
+		            program->word_count + 1, sizeof(word_t)) != 0) {
+			return -2;
+		}
+		word = &program->words[program->word_count++];
+		word->offset = start;
+		word->length = i - start;
+		instruction->word_count++;
+	}
+
+	// Resolve the command once
+	resolve_opcode(program, instruction);
+
+	program->text_size += length;
+	program->line_count++;
+	return 0;
+}
+
+/* ----------------------------------------------------------------------------
+ * @brief Resolves the command of an instruction from its first word.
+ * @param input  - program     - The program holding the instruction
+ *        input  - instruction - An instruction whose words are located
+ * ----------------------------------------------------------------------------
+ */
+void resolve_opcode(program_t *program, instruction_t *instruction) {
+	char command[MAX_CMD_LENGTH];
+	word_t *word;
+
+	if (instruction->word_count > 0) {
+		word = &program->words[instruction->first_word];
+		memcpy(command, program->text + instruction->line_offset +
+		       word->offset, word->length);
+		command[word->length] = '\0';
+		instruction->opcode = find_command(command);
+	} else {
+		instruction->opcode = COMMAND_UNKNOWN;
+	}
+}
+
+/* ----------------------------------------------------------------------------
+ * @brief Shares a compiled program through the cache. The cache holds its own
+ *        reference and replaces any previous program of the same file.
+ * @param input  - program - A fully compiled program
+ * ----------------------------------------------------------------------------
+ */
+void cache_program(program_t *program) {
+	unsigned int bucket;
+	program_t **link, *previous;
+
+	if (!program) {
+		return;
+	}
+
+	bucket = hash_filename(program->filename);
+	pthread_mutex_lock(&cache_lock);
+	for (link = &program_cache[bucket]; *link; link = &(*link)->next) {
+		if (strcmp((*link)->filename, program->filename) == 0) {
+			previous = *link;
+			*link = previous->next;
+			previous->next = NULL;
+			release_program(previous);
+			break;
+		}
+	}
+
+	retain_program(program);
+	program->next = program_cache[bucket];
+	program_cache[bucket] = program;
+	pthread_mutex_unlock(&cache_lock);
+}
+
+/* ----------------------------------------------------------------------------
+ * @brief Hashes text using 64-bit FNV-1a. Text read in parts is hashed by
+ *        passing the hash of the previous parts, starting from
+ *        CONTENT_HASH_SEED.
+ * @param input  - text - The text to hash
+ *        input  - size - The number of characters of the text
+ *        input  - hash - The hash of the text preceding it
+ * @return The hash of the text
+ * ----------------------------------------------------------------------------
+ */
+unsigned long long hash_text(char *text, long size, unsigned long long hash) {
+	long i;
+
+	for (i = 0; i < size; i++) {
+		hash ^= (unsigned char) text[i];
+		hash *= 1099511628211ull;
+	}
+	return hash;
+}
+
+/* ----------------------------------------------------------------------------
+ * @brief Reads the whole content of a file as the text of an empty program
+ *        and hashes it.
+ * @param input  - program - An empty program
+ *        input  - fd      - The descriptor of the script
+ * @return int - Status code
+ *                  0 - No errors
+ *                 -1 - The file could not be read
+ *                 -2 - Could not allocate new memory space
+ * ----------------------------------------------------------------------------
+ */
+int read_program_text(program_t *program, int fd) {
+	struct stat source;
+	ssize_t count;
+	long offset;
+
+	if (fstat(fd, &source) != 0 || source.st_size > MAX_PROGRAM_TEXT_SIZE) {
+		return -1;
+	}
+	if (reserve((void **) &program->text, &program->text_capacity,
+	            source.st_size, sizeof(char)) != 0) {
+		return -2;
+	}
+	for (offset = 0; offset < source.st_size; offset += count) {
+		count = pread(fd, program->text + offset, source.st_size - offset,
+		              offset);
+		if (count <= 0) {
+			return -1;
+		}
+	}
+	program->text_size = source.st_size;
+	program->content_hash = hash_text(program->text, program->text_size,
+	                                  CONTENT_HASH_SEED);
+	return 0;
+}
+
+/* ----------------------------------------------------------------------------
+ * @brief Compiles text held in memory, splitting it into lines as fgets
+ *        would with a buffer of MAX_CMD_LENGTH characters.
+ * @param input  - filename - The path of the script
+ *        input  - text     - The content of the script
+ *        input  - size     - The number of characters of the text
+ * @return A program with a single reference and the hash of its text. NULL
+ *         if memory could not be allocated or the text holds a null character
+ * ----------------------------------------------------------------------------
+ */
+program_t *compile_text(char *filename, char *text, int size) {
+	char line[MAX_CMD_LENGTH];
+	program_t *program;
+	int offset, length;
+
+	program = create_program(filename);
+	for (offset = 0; program && offset < size; offset += length) {
+		length = 0;
+		while (offset + length < size && length < MAX_CMD_LENGTH - 1 &&
+		       (length == 0 || text[offset + length - 1] != '\n')) {
+			length++;
+		}
+		memcpy(line, text + offset, length);
+		line[length] = '\0';
+		if (compile_line(program, line) != 0) {
+			release_program(program);
+			program = NULL;
+		}
+	}
+	if (program && program->text_size != size) {
+		release_program(program);
+		return NULL;
+	}
+	if (program) {
+		program->content_hash = hash_text(program->text, program->text_size,
+		                                  CONTENT_HASH_SEED);
+	}
+	return program;
+}
+
+/* ----------------------------------------------------------------------------
+ * @brief Writes the index of a compiled program: the location of its lines
+ *        and of their words within its text.
+ * @param input  - program - A fully compiled program
+ *        input  - path    - The file receiving the index
+ * @return int - Status code
+ *                  0 - No errors
+ *                 -1 - The index could not be written
+ * ----------------------------------------------------------------------------
+ */
+int save_program_index(program_t *program, char *path) {
+	program_index_t header;
+	FILE *file;
+	int err;
+
+	memset(&header, 0, sizeof(program_index_t));
+	header.magic = PROGRAM_INDEX_MAGIC;
+	header.version = PROGRAM_INDEX_VERSION;
+	header.content_hash = program->content_hash;
+	header.text_size = program->text_size;
+	header.line_count = program->line_count;
+	header.word_count = program->word_count;
+	header.max_line_length = MAX_CMD_LENGTH;
+	header.max_words = MAX_WORDS;
+
+	file = fopen(path, "wb");
+	if (!file) {
+		return -1;
+	}
+	err = fwrite(&header, sizeof(program_index_t), 1, file) != 1 ||
+	      fwrite(program->code, sizeof(instruction_t), program->line_count,
+	             file) != (size_t) program->line_count ||
+	      fwrite(program->words, sizeof(word_t), program->word_count,
+	             file) != (size_t) program->word_count;
+	if (fclose(file) != 0 || err) {
+		return -1;
+	}
+	return 0;
+}
+
+/* ----------------------------------------------------------------------------
+ * @brief Loads the index of a program whose text was read, instead of
+ *        compiling it. The index must have been written for the same text by
+ *        the same version of the compiler.
+ * @param input  - program - A program holding only its text
+ *        input  - path    - The file holding the index
+ * @return int - Status code
+ *                  0 - No errors
+ *                 -1 - The index is missing or does not match the text
+ *                 -2 - Could not allocate new memory space
+ * ----------------------------------------------------------------------------
+ */
+int load_program_index(program_t *program, char *path) {
+	program_index_t header;
+	struct stat index;
+	FILE *file;
+	int i, err;
+
+	file = fopen(path, "rb");
+	if (!file) {
+		return -1;
+	}
+	if (fread(&header, sizeof(program_index_t), 1, file) != 1 ||
+	    fstat(fileno(file), &index) != 0 ||
+	    header.magic != PROGRAM_INDEX_MAGIC ||
+	    header.version != PROGRAM_INDEX_VERSION ||
+	    header.content_hash != program->content_hash ||
+	    header.text_size != program->text_size ||
+	    header.max_line_length != MAX_CMD_LENGTH ||
+	    header.max_words != MAX_WORDS ||
+	    header.line_count < 0 || header.word_count < 0 ||
+	    index.st_size != (off_t) (sizeof(program_index_t) +
+	                              sizeof(instruction_t) * header.line_count +
+	                              sizeof(word_t) * header.word_count)) {
+		fclose(file);
+		return -1;
+	}
+
+	if (reserve((void **) &program->code, &program->code_capacity,
+	            header.line_count, sizeof(instruction_t)) != 0 ||
+	    reserve((void **) &program->words, &program->word_capacity,
+	            header.word_count, sizeof(word_t)) != 0) {
+		fclose(file);
+		return -2;
+	}
+	err = fread(program->code, sizeof(instruction_t), header.line_count,
+	            file) != (size_t) header.line_count ||
+	      fread(program->words, sizeof(word_t), header.word_count,
+	            file) != (size_t) header.word_count;
+	fclose(file);
+	program->line_count = header.line_count;
+	program->word_count = header.word_count;
+	if (err || check_program_index(program) != 0) {
+		program->line_count = 0;
+		program->word_count = 0;
+		return -1;
+	}
+
+	for (i = 0; i < program->line_count; i++) {
+		resolve_opcode(program, &program->code[i]);
+	}
+	return 0;
+}
+
+/* ----------------------------------------------------------------------------
+ * @brief Checks that the lines of a loaded index follow each other through
+ *        the whole text and that their words lie within them, so that a
+ *        damaged index cannot make a CPU read outside the program.
+ * @param input  - program - A program holding its text and its index
+ * @return int - Status code
+ *                  0 - No errors
+ *                 -1 - The index does not match the text
+ * ----------------------------------------------------------------------------
+ */
+int check_program_index(program_t *program) {
+	instruction_t *instruction;
+	word_t *word;
+	int i, j, offset, first_word;
+
+	offset = 0;
+	first_word = 0;
+	for (i = 0; i < program->line_count; i++) {
+		instruction = &program->code[i];
+		if (instruction->line_offset != offset ||
+		    instruction->line_length <= 0 ||
+		    instruction->line_length >= MAX_CMD_LENGTH ||
+		    instruction->line_length > program->text_size - offset ||
+		    instruction->first_word != first_word ||
+		    instruction->word_count < 0 ||
+		    instruction->word_count > program->word_count - first_word) {
+			return -1;
+		}
+		for (j = 0; j < instruction->word_count; j++) {
+			word = &program->words[first_word + j];
+			if (word->length == 0 ||
+			    word->offset + word->length > instruction->line_length) {
+				return -1;
+			}
+		}
+		offset += instruction->line_length;
+		first_word += instruction->word_count;
+	}
+	if (offset != program->text_size || first_word != program->word_count) {
+		return -1;
+	}
+	return 0;
+}
+
+/* ----------------------------------------------------------------------------
+ * @brief Returns the compiled program of a file, compiling it if it is not
+ *        cached or was modified.
+ * @param input  - filename - The path of the script
+ * @return A retained program. NULL if the file cannot be read
+ * ----------------------------------------------------------------------------
+ */
+program_t *load_program(char *filename) {
+	char line[MAX_LINE_LENGTH];
+	program_t *program;
+	FILE *file;
+
+	program = find_program(filename);
+	if (program) {
+		return program;
+	}
+
+	file = fopen(filename, "r");
+	if (!file) {
+		return NULL;
+	}
+
+	program = create_program(filename);
+	while (program && fgets(line, MAX_LINE_LENGTH, file)) {
+		if (compile_line(program, line) != 0) {
+			release_program(program);
+			program = NULL;
+		}
+	}
+	fclose(file);
+
+	cache_program(program);
+	return program;
+}
+
+/* ----------------------------------------------------------------------------
+ * @brief Adds a reference to a program. Programs are shared by every CPU so
+ *        references are counted atomically.
+ * ----------------------------------------------------------------------------
+ */
+void retain_program(program_t *program) {
+	if (program) {
+		__atomic_add_fetch(&program->references, 1, __ATOMIC_RELAXED);
+	}
+}
+
+/* ----------------------------------------------------------------------------
+ * @brief Drops a reference to a program. The program is freed with its last
+ *        reference.
+ * ----------------------------------------------------------------------------
+ */
+void release_program(program_t *program) {
+	if (program &&
+	    __atomic_sub_fetch(&program->references, 1, __ATOMIC_ACQ_REL) == 0) {
+		free_program(program);
+	}
+}
+
+/* ----------------------------------------------------------------------------
+ * @brief Frees a program and all of its resources.
+ * ----------------------------------------------------------------------------
+ */
+void free_program(program_t *program) {
+	free(program->filename);
+	free(program->text);
+	free(program->code);
+	free(program->words);
+	free(program);
+}
@@ -0,0 +1,68 @@
+/* ----------------------------------------------------------------------------
+ * @file PROGRAM.H
+ * @author Si Xun Li - 260674916
+ * @version 1.0
+ * @brief This file is the header file for compiled scripts.
+ * ----------------------------------------------------------------------------
+ */
+
+#include <sys/stat.h>
+
+/*
+ * A compiled script. Every line becomes an instruction holding its resolved
+ * command and the offsets of its words within the line, so executing a line
+ * needs neither parsing nor string comparisons.
+ * The content hash names the program's entry in the backing store.
+ */
+#ifndef PROGRAM_H
+#define PROGRAM_H
+typedef struct word word_t;
+struct word {
+	unsigned short offset;
+	unsigned short length;
+};
+
+typedef struct instruction instruction_t;
+struct instruction {
+	int opcode;
+	int line_offset;
+	int line_length;
+	int first_word;
+	int word_count;
+};
+
+typedef struct program program_t;
+struct program {
+	char *filename;
+	struct stat source;
+	unsigned long long content_hash;
+	char *text;
+	int text_size;
+	int text_capacity;
+	instruction_t *code;
+	int line_count;
+	int code_capacity;
+	word_t *words;
+	int word_count;
+	int word_capacity;
+	int references;
+	program_t *next;
+};
+#endif
+
+/*
+ * Available functions for compiled scripts
+ */
+program_t *find_program(char *filename);
+program_t *create_program(char *filename);
+int compile_line(program_t *program, char *line);
+int reserve(void **array, int *capacity, int needed, size_t element_size);
+void cache_program(program_t *program);
+unsigned long long hash_text(char *text, long size, unsigned long long hash);
+int read_program_text(program_t *program, int fd);
+program_t *compile_text(char *filename, char *text, int size);
+int save_program_index(program_t *program, char *path);
+int load_program_index(program_t *program, char *path);
+program_t *load_program(char *filename);
+void retain_program(program_t *program);
+void release_program(program_t *program);
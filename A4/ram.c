@@ -12,11 +12,18 @@
 #include "constant.h"
 
 /*
- * RAM structure
+ * RAM structure. Holds the file of every loaded process in a slot. Freed
+ * slots are stacked so that loading and removing a file do not search. The
+ * slots grow as files are loaded, the number of loaded processes being
+ * bounded by the kernel's admission.
  */
 typedef struct ram ram_t;
 struct ram {
-	FILE *files[RAM_SIZE * RAM_SIZE];
+	FILE **files;
+	int *free_slots;
+	int free_count;
+	int used;
+	int capacity;
 };
 ram_t *memory;
 
@@ -25,50 +32,66 @@ ram_t *memory;
  * ----------------------------------------------------------------------------
  */
 void init_ram() {
-	memory = (ram_t *) malloc(sizeof(ram_t));
+	memory = (ram_t *) calloc(1, sizeof(ram_t));
 }
 
 /* ----------------------------------------------------------------------------
- * @brief Inserts the file pointer to the next available spot.
+ * @brief Inserts the file pointer to the next available slot.
  * @param input  - file    A file pointer
- * @return int - Status code
- *                  0 - No errors
- *                 -1 - Failed to find free spot in memory
+ * @return int - The slot of the file. -1 if no memory is available
  * ----------------------------------------------------------------------------
  */
 int add_to_ram(FILE *file) {
-	int i;
-	for (i = 0; i < (RAM_SIZE * RAM_SIZE); i++) {
-		if(!memory->files[i]) {
-			memory->files[i] = file;
-			printf("Loaded file to memory\n");
-			return 0;
+	FILE **files;
+	int *free_slots;
+	int slot, capacity;
+
+	if (memory->free_count > 0) {
+		slot = memory->free_slots[--memory->free_count];
+	} else {
+		if (memory->used == memory->capacity) {
+			capacity = memory->capacity ? memory->capacity * 2 :
+			           DEFAULT_RAM_SIZE;
+			files = (FILE **) realloc(memory->files,
+			                          sizeof(FILE *) * capacity);
+			if (files) {
+				memory->files = files;
+			}
+			free_slots = (int *) realloc(memory->free_slots,
+			                             sizeof(int) * capacity);
+			if (free_slots) {
+				memory->free_slots = free_slots;
+			}
+			if (!files || !free_slots) {
+				printf("No memory available to load file\n");
+				return -1;
+			}
+			memory->capacity = capacity;
 		}
+		slot = memory->used++;
 	}
 
-	printf("No memory available to load file\n");
-	return -1;
+	memory->files[slot] = file;
+	printf("Loaded file to memory\n");
+	return slot;
 }
 
 /* ----------------------------------------------------------------------------
- * @brief Removes a file pointer.
- * @param input  - file    A file pointer
+ * @brief Removes and closes the file in a slot.
+ * @param input  - slot    The slot returned by add_to_ram
  * @return int - Status code
  *                  0 - No errors
- *                 -1 - Failed to find process in memory
+ *                 -1 - The slot holds no file
  * ----------------------------------------------------------------------------
  */
-int remove_from_ram(FILE *file) {
-	int i;
-	for (i = 0; i < (RAM_SIZE * RAM_SIZE); i++) {
-		// Check if not null first, then compare
-		if (memory->files[i] && memory->files[i] == file) {
-			fclose(memory->files[i]);
-			memory->files[i] = NULL;
-			return 0;
-		}
+int remove_from_ram(int slot) {
+	if (slot < 0 || slot >= memory->used || !memory->files[slot]) {
+		return -1;
 	}
-	return -1;
+	fclose(memory->files[slot]);
+	memory->files[slot] = NULL;
+	memory->free_slots[memory->free_count++] = slot;
+	return 0;
 }
 
 /* ----------------------------------------------------------------------------
@@ -77,12 +100,14 @@ int remove_from_ram(FILE *file) {
  */
 void clear_ram() {
 	int i;
-	for (i = 0; i < (RAM_SIZE * RAM_SIZE); i++) {
+	for (i = 0; i < memory->used; i++) {
 		if (memory->files[i]) {
 			fclose(memory->files[i]);
 			memory->files[i] = NULL;
 		}
 	}
+	memory->used = 0;
+	memory->free_count = 0;
 }
 
 /* ----------------------------------------------------------------------------
@@ -91,7 +116,7 @@ void clear_ram() {
  */
 void print_ram() {
 	int i;
-	for (i = 0; i < (RAM_SIZE * RAM_SIZE); i++) {
+	for (i = 0; i < memory->used; i++) {
 		printf("%d %p\n", i, memory->files[i]);
 	}
 }
@@ -11,6 +11,6 @@
  */
 void init_ram();
 int add_to_ram(FILE *file);
-int remove_from_ram(FILE *file);
+int remove_from_ram(int slot);
 void clear_ram();
 void print_ram();
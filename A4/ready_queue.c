@@ -0,0 +1,275 @@
+/* ----------------------------------------------------------------------------
+ * @file READY_QUEUE.C
+ * @author Si Xun Li - 260674916
+ * @version 1.0
+ * @brief This file contains a bounded multi-producer multi-consumer queue of
+ *        PCBs. Producers and consumers claim a cell by advancing a position
+ *        with a compare-and-swap. The sequence number of the cell tells them
+ *        whether it is free, full or was already claimed by another CPU. No
+ *        lock is taken and nothing is allocated once the queue is created.
+ *        It also contains the run queue of each CPU, a deque guarded by a lock
+ *        that is only contended when another CPU steals.
+ * ----------------------------------------------------------------------------
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "constant.h"
+#include "ready_queue.h"
+
+/* ----------------------------------------------------------------------------
+ * @brief Creates an empty queue.
+ * @param input  - capacity - Number of cells, a power of two
+ * @return A queue. NULL if the capacity is invalid or memory could not be
+ *         allocated
+ * ----------------------------------------------------------------------------
+ */
+ready_queue_t *create_ready_queue(size_t capacity) {
+	ready_queue_t *queue;
+	size_t i;
+
+	if (capacity < 2 || (capacity & (capacity - 1)) != 0) {
+		return NULL;
+	}
+
+	queue = (ready_queue_t *) calloc(1, sizeof(ready_queue_t));
+	if (!queue) {
+		return NULL;
+	}
+	queue->cells = (ready_cell_t *) malloc(sizeof(ready_cell_t) * capacity);
+	if (!queue->cells) {
+		free(queue);
+		return NULL;
+	}
+
+	// A cell is free for the producer whose position equals its sequence
+	for (i = 0; i < capacity; i++) {
+		queue->cells[i].sequence = i;
+		queue->cells[i].pcb = NULL;
+	}
+	queue->mask = capacity - 1;
+	queue->enqueue_position = 0;
+	queue->dequeue_position = 0;
+	return queue;
+}
+
+/* ----------------------------------------------------------------------------
+ * @brief Frees a queue. The PCBs still in the queue are not freed.
+ * ----------------------------------------------------------------------------
+ */
+void free_ready_queue(ready_queue_t *queue) {
+	if (queue) {
+		free(queue->cells);
+		free(queue);
+	}
+}
+
+/* ----------------------------------------------------------------------------
+ * @brief Adds a PCB at the end of the queue.
+ * @param input  - queue - A queue
+ *        input  - pcb   - The PCB to add
+ * @return int - Status code
+ *                  0 - No errors
+ *                 -1 - The queue is full
+ * ----------------------------------------------------------------------------
+ */
+int enqueue_ready(ready_queue_t *queue, pcb_t *pcb) {
+	ready_cell_t *cell;
+	size_t position, sequence;
+	long difference;
+
+	position = __atomic_load_n(&queue->enqueue_position, __ATOMIC_RELAXED);
+	while(1) {
+		cell = &queue->cells[position & queue->mask];
+		sequence = __atomic_load_n(&cell->sequence, __ATOMIC_ACQUIRE);
+		difference = (long) sequence - (long) position;
+		if (difference == 0) {
+			// The cell is free, claim it
+			if (__atomic_compare_exchange_n(&queue->enqueue_position,
+			                                &position, position + 1, 1,
+			                                __ATOMIC_RELAXED,
+			                                __ATOMIC_RELAXED)) {
+				break;
+			}
+		} else if (difference < 0) {
+			// The cell still holds the PCB of a previous lap
+			return -1;
+		} else {
+			// Another producer claimed the cell first
+			position = __atomic_load_n(&queue->enqueue_position,
+			                           __ATOMIC_RELAXED);
+		}
+	}
+
+	cell->pcb = pcb;
+	__atomic_store_n(&cell->sequence, position + 1, __ATOMIC_RELEASE);
+	return 0;
+}
+
+/* ----------------------------------------------------------------------------
+ * @brief Removes the PCB at the front of the queue.
+ * @param input  - queue - A queue
+ * @return A PCB. NULL if the queue is empty
+ * ----------------------------------------------------------------------------
+ */
+pcb_t *dequeue_ready(ready_queue_t *queue) {
+	ready_cell_t *cell;
+	size_t position, sequence;
+	long difference;
+	pcb_t *pcb;
+
+	position = __atomic_load_n(&queue->dequeue_position, __ATOMIC_RELAXED);
+	while(1) {
+		cell = &queue->cells[position & queue->mask];
+		sequence = __atomic_load_n(&cell->sequence, __ATOMIC_ACQUIRE);
+		difference = (long) sequence - (long) (position + 1);
+		if (difference == 0) {
+			// The cell is full, claim it
+			if (__atomic_compare_exchange_n(&queue->dequeue_position,
+			                                &position, position + 1, 1,
+			                                __ATOMIC_RELAXED,
+			                                __ATOMIC_RELAXED)) {
+				break;
+			}
+		} else if (difference < 0) {
+			// No producer filled the cell yet
+			return NULL;
+		} else {
+			// Another consumer claimed the cell first
+			position = __atomic_load_n(&queue->dequeue_position,
+			                           __ATOMIC_RELAXED);
+		}
+	}
+
+	pcb = cell->pcb;
+	// Free the cell for the producer one lap ahead
+	__atomic_store_n(&cell->sequence, position + queue->mask + 1,
+	                 __ATOMIC_RELEASE);
+	return pcb;
+}
+
+/* ----------------------------------------------------------------------------
+ * @brief Checks if the queue is empty. The answer may be stale as soon as it
+ *        is returned if other CPUs use the queue.
+ * @return int - 1 if the queue is empty, 0 otherwise
+ * ----------------------------------------------------------------------------
+ */
+int is_ready_queue_empty(ready_queue_t *queue) {
+	return __atomic_load_n(&queue->dequeue_position, __ATOMIC_SEQ_CST) >=
+	       __atomic_load_n(&queue->enqueue_position, __ATOMIC_SEQ_CST);
+}
+
+/* ----------------------------------------------------------------------------
+ * @brief Initializes an empty run queue.
+ * @param input  - queue - The run queue of a CPU
+ * @return int - Status code
+ *                  0 - No errors
+ *                 -1 - Memory could not be allocated
+ * ----------------------------------------------------------------------------
+ */
+int init_cpu_queue(cpu_queue_t *queue) {
+	pthread_mutex_init(&queue->lock, NULL);
+	queue->slots = (pcb_t **) malloc(sizeof(pcb_t *) *
+	                                 CPU_QUEUE_INITIAL_CAPACITY);
+	if (!queue->slots) {
+		return -1;
+	}
+	queue->capacity = CPU_QUEUE_INITIAL_CAPACITY;
+	queue->head = 0;
+	queue->count = 0;
+	return 0;
+}
+
+/* ----------------------------------------------------------------------------
+ * @brief Adds a PCB at the tail of a run queue. The slots are doubled when
+ *        the queue is full.
+ * @param input  - queue - The run queue of a CPU
+ *        input  - pcb   - The PCB to add
+ * @return int - Status code
+ *                  0 - No errors
+ *                 -1 - Memory could not be allocated
+ * ----------------------------------------------------------------------------
+ */
+int push_cpu_queue(cpu_queue_t *queue, pcb_t *pcb) {
+	pcb_t **slots;
+	size_t i;
+
+	pthread_mutex_lock(&queue->lock);
+	if (queue->count == queue->capacity) {
+		slots = (pcb_t **) malloc(sizeof(pcb_t *) * queue->capacity * 2);
+		if (!slots) {
+			pthread_mutex_unlock(&queue->lock);
+			return -1;
+		}
+		// Unwrap the ring at the start of the new slots
+		for (i = 0; i < queue->count; i++) {
+			slots[i] = queue->slots[(queue->head + i) % queue->capacity];
+		}
+		free(queue->slots);
+		queue->slots = slots;
+		queue->capacity *= 2;
+		queue->head = 0;
+	}
+	queue->slots[(queue->head + queue->count) % queue->capacity] = pcb;
+	__atomic_store_n(&queue->count, queue->count + 1, __ATOMIC_SEQ_CST);
+	pthread_mutex_unlock(&queue->lock);
+	return 0;
+}
+
+/* ----------------------------------------------------------------------------
+ * @brief Removes the PCB at the head of a run queue. Used by the CPU owning
+ *        the queue.
+ * @param input  - queue - The run queue of a CPU
+ * @return A PCB. NULL if the queue is empty
+ * ----------------------------------------------------------------------------
+ */
+pcb_t *pop_cpu_queue(cpu_queue_t *queue) {
+	pcb_t *pcb = NULL;
+
+	if (__atomic_load_n(&queue->count, __ATOMIC_SEQ_CST) == 0) {
+		return NULL;
+	}
+
+	pthread_mutex_lock(&queue->lock);
+	if (queue->count > 0) {
+		pcb = queue->slots[queue->head];
+		queue->head = (queue->head + 1) % queue->capacity;
+		__atomic_store_n(&queue->count, queue->count - 1, __ATOMIC_SEQ_CST);
+	}
+	pthread_mutex_unlock(&queue->lock);
+	return pcb;
+}
+
+/* ----------------------------------------------------------------------------
+ * @brief Removes the PCB at the tail of another CPU's run queue. A queue with
+ *        a single process is left alone: its CPU is about to run it again and
+ *        taking it would only move it back and forth between CPUs.
+ * @param input  - queue - The run queue of another CPU
+ * @return A PCB. NULL if there is nothing to steal
+ * ----------------------------------------------------------------------------
+ */
+pcb_t *steal_cpu_queue(cpu_queue_t *queue) {
+	pcb_t *pcb = NULL;
+
+	if (__atomic_load_n(&queue->count, __ATOMIC_SEQ_CST) < 2) {
+		return NULL;
+	}
+
+	pthread_mutex_lock(&queue->lock);
+	if (queue->count >= 2) {
+		pcb = queue->slots[(queue->head + queue->count - 1) %
+		                   queue->capacity];
+		__atomic_store_n(&queue->count, queue->count - 1, __ATOMIC_SEQ_CST);
+	}
+	pthread_mutex_unlock(&queue->lock);
+	return pcb;
+}
+
+/* ----------------------------------------------------------------------------
+ * @brief Returns the number of PCBs in a run queue without locking it. The
+ *        answer may be stale as soon as it is returned.
+ * ----------------------------------------------------------------------------
+ */
+size_t cpu_queue_size(cpu_queue_t *queue) {
+	return __atomic_load_n(&queue->count, __ATOMIC_SEQ_CST);
+}
@@ -0,0 +1,64 @@
+/* ----------------------------------------------------------------------------
+ * @file READY_QUEUE.H
+ * @author Si Xun Li - 260674916
+ * @version 1.0
+ * @brief This file is the header file for the ready queue.
+ * ----------------------------------------------------------------------------
+ */
+
+#include <stddef.h>
+#include <pthread.h>
+#include "pcb.h"
+
+/*
+ * Bounded ring of PCBs. Each cell carries a sequence number telling producers
+ * and consumers whose turn it is to use the cell.
+ */
+#ifndef READY_QUEUE_H
+#define READY_QUEUE_H
+typedef struct ready_cell ready_cell_t;
+struct ready_cell {
+	size_t sequence;
+	pcb_t *pcb;
+};
+
+typedef struct ready_queue ready_queue_t;
+struct ready_queue {
+	ready_cell_t *cells;
+	size_t mask;
+	char padding_0[CACHE_LINE_SIZE];
+	size_t enqueue_position;
+	char padding_1[CACHE_LINE_SIZE];
+	size_t dequeue_position;
+	char padding_2[CACHE_LINE_SIZE];
+};
+
+/*
+ * Run queue of a CPU. The CPU takes processes from the head and puts them back
+ * at the tail. Other CPUs steal from the tail. The ring of slots grows as
+ * needed.
+ */
+typedef struct cpu_queue cpu_queue_t;
+struct cpu_queue {
+	pthread_mutex_t lock;
+	pcb_t **slots;
+	size_t capacity;
+	size_t head;
+	size_t count;
+	char padding[CACHE_LINE_SIZE];
+};
+#endif
+
+/*
+ * Available functions for the ready queue
+ */
+ready_queue_t *create_ready_queue(size_t capacity);
+void free_ready_queue(ready_queue_t *queue);
+int enqueue_ready(ready_queue_t *queue, pcb_t *pcb);
+pcb_t *dequeue_ready(ready_queue_t *queue);
+int is_ready_queue_empty(ready_queue_t *queue);
+int init_cpu_queue(cpu_queue_t *queue);
+int push_cpu_queue(cpu_queue_t *queue, pcb_t *pcb);
+pcb_t *pop_cpu_queue(cpu_queue_t *queue);
+pcb_t *steal_cpu_queue(cpu_queue_t *queue);
+size_t cpu_queue_size(cpu_queue_t *queue);
@@ -0,0 +1,312 @@
+/* ----------------------------------------------------------------------------
+ * @file REPLACEMENT.C
+ * @author Si Xun Li - 260674916
+ * @version 1.0
+ * @brief This file contains the page replacement policies:
+ *            - random        - A random frame.
+ *            - fifo          - The frame loaded first.
+ *            - second-chance - The frame loaded first, unless it was
+ *                              referenced since it was last considered, in
+ *                              which case it goes to the back of the queue.
+ *            - clock         - The first frame the hand finds unreferenced,
+ *                              clearing the reference bits it passes.
+ *            - lru           - The least recently used frame.
+ *            - working-set   - The first frame the hand finds outside the
+ *                              working set of every process, or the least
+ *                              recently used frame if every frame is in one.
+ *        Every policy prefers the frames of other processes to those of the
+ *        process needing a frame and never selects a pinned frame.
+ * ----------------------------------------------------------------------------
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "constant.h"
+#include "replacement.h"
+#include "memorymanager.h"
+
+/*
+ * Use of each frame. Times count the references to frames so that they do
+ * not depend on the speed of the CPUs. The reference bit is set when a CPU
+ * references the frame and cleared by the policies looking at it.
+ */
+typedef struct frame_use frame_use_t;
+struct frame_use {
+	unsigned long loaded;
+	unsigned long used;
+	int referenced;
+};
+
+/*
+ * Policy functions
+ */
+int random_victim(pcb_t *pcb);
+int fifo_victim(pcb_t *pcb);
+int second_chance_victim(pcb_t *pcb);
+int clock_victim(pcb_t *pcb);
+int lru_victim(pcb_t *pcb);
+int working_set_victim(pcb_t *pcb);
+int is_candidate(int frame_number, pcb_t *pcb, int pass);
+int find_oldest(pcb_t *pcb, int by_use);
+
+replacement_t replacements[] = {
+	{"random", random_victim, 0, 0},
+	{"fifo", fifo_victim, 0, 0},
+	{"second-chance", second_chance_victim, 0, 0},
+	{"clock", clock_victim, 0, 0},
+	{"lru", lru_victim, 0, 0},
+	{"working-set", working_set_victim, 0, 0}
+};
+const int REPLACEMENT_COUNT = sizeof(replacements) / sizeof(replacement_t);
+
+replacement_t *replacement = &replacements[0];
+
+// Guarded by the frames
+frame_use_t *frame_uses;
+int frame_count = 0;
+unsigned long references = 0;
+int clock_hand = 0;
+
+/* ----------------------------------------------------------------------------
+ * @brief Allocates the use of every frame. This code should be called only a
+ *        single time.
+ * @param input  - frames - Number of frames of RAM
+ * @return int - Status code
+ *                  0 - No errors
+ *                 -1 - Memory could not be allocated
+ * ----------------------------------------------------------------------------
+ */
+int init_replacement(int frames) {
+	frame_uses = (frame_use_t *) calloc(frames, sizeof(frame_use_t));
+	if (!frame_uses) {
+		return -1;
+	}
+	frame_count = frames;
+	return 0;
+}
+
+/* ----------------------------------------------------------------------------
+ * @brief Finds a policy by name.
+ * @param input  - name - The name of the policy
+ * @return The policy. NULL if no policy has this name
+ * ----------------------------------------------------------------------------
+ */
+replacement_t *find_replacement(char *name) {
+	int i;
+
+	for (i = 0; i < REPLACEMENT_COUNT; i++) {
+		if (strcmp(replacements[i].name, name) == 0) {
+			return &replacements[i];
+		}
+	}
+	return NULL;
+}
+
+/* ----------------------------------------------------------------------------
+ * @brief Returns the selected policy.
+ * ----------------------------------------------------------------------------
+ */
+replacement_t *get_replacement() {
+	return replacement;
+}
+
+/* ----------------------------------------------------------------------------
+ * @brief Selects a policy. Must be called before any page is loaded.
+ * @param input  - new_replacement - The policy to select
+ * ----------------------------------------------------------------------------
+ */
+void set_replacement(replacement_t *new_replacement) {
+	replacement = new_replacement;
+}
+
+/* ----------------------------------------------------------------------------
+ * @brief Prints the name of every policy.
+ * ----------------------------------------------------------------------------
+ */
+void print_replacements() {
+	int i;
+
+	for (i = 0; i < REPLACEMENT_COUNT; i++) {
+		printf(TAB "%s\n", replacements[i].name);
+	}
+}
+
+/* ----------------------------------------------------------------------------
+ * @brief Records that a page was loaded into a frame.
+ * @param input  - frame_number - The number of the frame
+ * ----------------------------------------------------------------------------
+ */
+void load_frame(int frame_number) {
+	if (frame_number >= 0 && frame_number < frame_count) {
+		frame_uses[frame_number].loaded = ++references;
+		frame_uses[frame_number].used = references;
+		frame_uses[frame_number].referenced = 1;
+	}
+}
+
+/* ----------------------------------------------------------------------------
+ * @brief Records that a CPU accessed the page held by a frame, when it
+ *        dispatches a process or the process moves to its next page.
+ * @param input  - frame_number - The number of the frame
+ *        input  - hit          - Was the page in the frame before the access
+ * ----------------------------------------------------------------------------
+ */
+void reference_frame(int frame_number, int hit) {
+	if (frame_number >= 0 && frame_number < frame_count) {
+		frame_uses[frame_number].used = ++references;
+		frame_uses[frame_number].referenced = 1;
+	}
+	if (hit) {
+		replacement->hits++;
+	} else {
+		replacement->misses++;
+	}
+}
+
+/* ----------------------------------------------------------------------------
+ * @brief Checks if a process may take a frame. The frames of the process are
+ *        only considered on the second pass.
+ * @param input  - frame_number - The number of the frame
+ *        input  - pcb          - The process needing a frame
+ *        input  - pass         - 0 for the frames of other processes, 1 for
+ *                                every frame
+ * @return 1 if the frame may be taken, 0 otherwise
+ * ----------------------------------------------------------------------------
+ */
+int is_candidate(int frame_number, pcb_t *pcb, int pass) {
+	return !is_frame_pinned(frame_number) &&
+	       (pass == 1 || !is_frame_mapped(frame_number, pcb));
+}
+
+/* ----------------------------------------------------------------------------
+ * @brief Finds the frame loaded or used first.
+ * @param input  - pcb    - The process needing a frame
+ *        input  - by_use - 1 to compare the last use, 0 to compare the load
+ * @return The number of the frame. -1 if every frame is pinned
+ * ----------------------------------------------------------------------------
+ */
+int find_oldest(pcb_t *pcb, int by_use) {
+	unsigned long time, oldest = 0;
+	int i, pass, victim;
+
+	for (pass = 0; pass < 2; pass++) {
+		victim = -1;
+		for (i = 0; i < frame_count; i++) {
+			if (!is_candidate(i, pcb, pass)) {
+				continue;
+			}
+			time = by_use ? frame_uses[i].used : frame_uses[i].loaded;
+			if (victim == -1 || time < oldest) {
+				victim = i;
+				oldest = time;
+			}
+		}
+		if (victim != -1) {
+			return victim;
+		}
+	}
+	return -1;
+}
+
+/* ----------------------------------------------------------------------------
+ * @brief Selects a random frame, or the first frame following it that may be
+ *        taken.
+ * @return The number of the frame. -1 if every frame is pinned
+ * ----------------------------------------------------------------------------
+ */
+int random_victim(pcb_t *pcb) {
+	int r, i, pass;
+
+	// Randomly select the victim
+	r = rand() % frame_count;
+	if (is_candidate(r, pcb, 0)) {
+		return r;
+	}
+
+	// Iteratively increase until a spot is found to be occupied by another PCB
+	for (pass = 0; pass < 2; pass++) {
+		for (i = r; i < r + frame_count; i++) {
+			if (is_candidate(i % frame_count, pcb, pass)) {
+				return i % frame_count;
+			}
+		}
+	}
+	return -1;
+}
+
+int fifo_victim(pcb_t *pcb) {
+	return find_oldest(pcb, 0);
+}
+
+int lru_victim(pcb_t *pcb) {
+	return find_oldest(pcb, 1);
+}
+
+/* ----------------------------------------------------------------------------
+ * @brief Selects the frame loaded first that was not referenced. Referenced
+ *        frames lose their bit and move to the back of the queue, so the loop
+ *        ends once every candidate was considered.
+ * @return The number of the frame. -1 if every frame is pinned
+ * ----------------------------------------------------------------------------
+ */
+int second_chance_victim(pcb_t *pcb) {
+	int victim;
+
+	while ((victim = find_oldest(pcb, 0)) != -1 &&
+	       frame_uses[victim].referenced) {
+		frame_uses[victim].referenced = 0;
+		frame_uses[victim].loaded = ++references;
+	}
+	return victim;
+}
+
+/* ----------------------------------------------------------------------------
+ * @brief Moves the hand to the first frame that was not referenced. Two turns
+ *        of the hand clear every reference bit.
+ * @return The number of the frame. -1 if every frame is pinned
+ * ----------------------------------------------------------------------------
+ */
+int clock_victim(pcb_t *pcb) {
+	int i, pass, step;
+
+	for (pass = 0; pass < 2; pass++) {
+		for (step = 0; step < 2 * frame_count; step++) {
+			i = clock_hand;
+			clock_hand = (clock_hand + 1) % frame_count;
+			if (!is_candidate(i, pcb, pass)) {
+				continue;
+			}
+			if (frame_uses[i].referenced) {
+				frame_uses[i].referenced = 0;
+				continue;
+			}
+			return i;
+		}
+	}
+	return -1;
+}
+
+/* ----------------------------------------------------------------------------
+ * @brief Moves the hand to the first frame whose page is in no working set,
+ *        the pages referenced within the last WORKING_SET_WINDOW references.
+ * @return The number of the frame. -1 if every frame is pinned
+ * ----------------------------------------------------------------------------
+ */
+int working_set_victim(pcb_t *pcb) {
+	int i, pass, step;
+
+	for (pass = 0; pass < 2; pass++) {
+		for (step = 0; step < frame_count; step++) {
+			i = clock_hand;
+			clock_hand = (clock_hand + 1) % frame_count;
+			if (is_candidate(i, pcb, pass) &&
+			    references - frame_uses[i].used > WORKING_SET_WINDOW) {
+				return i;
+			}
+		}
+	}
+
+	// Every frame is in a working set
+	return find_oldest(pcb, 1);
+}
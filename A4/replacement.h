@@ -0,0 +1,37 @@
+/* ----------------------------------------------------------------------------
+ * @file REPLACEMENT.H
+ * @author Si Xun Li - 260674916
+ * @version 1.0
+ * @brief This file is the header file for the page replacement policies.
+ * ----------------------------------------------------------------------------
+ */
+
+#include "pcb.h"
+
+/*
+ * Page replacement policy. The memory manager asks the policy for a victim
+ * when no frame is empty. Each policy counts the accesses of processes to
+ * their pages that found the page in a frame and those that faulted. Every
+ * function is called with the frames locked.
+ */
+#ifndef REPLACEMENT_H
+#define REPLACEMENT_H
+typedef struct replacement replacement_t;
+struct replacement {
+	char *name;
+	int (*victim)(pcb_t *pcb);
+	unsigned long hits;
+	unsigned long misses;
+};
+#endif
+
+/*
+ * Available functions for the page replacement policies
+ */
+int init_replacement(int frames);
+replacement_t *find_replacement(char *name);
+replacement_t *get_replacement();
+void set_replacement(replacement_t *replacement);
+void print_replacements();
+void load_frame(int frame_number);
+void reference_frame(int frame_number, int hit);
@@ -14,6 +14,7 @@
 #include <ctype.h>
 #include "interpreter.h"
 #include "shell.h"
+#include "console.h"
 
 /* ----------------------------------------------------------------------------
  * @brief Prompts the user for an input. 
@@ -37,35 +38,22 @@
  * ----------------------------------------------------------------------------
  */
 int prompt_command() {
-	int num_of_words, trimmed_cmd_len, err, i;
+	int num_of_words, err;
 	char cmd[MAX_CMD_LENGTH];
-	char trimmed_cmd[MAX_CMD_LENGTH];
-	char **words;
-
-	words = malloc(sizeof(char *) * (MAX_CMD_LENGTH / 2));
-	for (i = 0; i < (MAX_CMD_LENGTH / 2); i++) {
-		words[i] = malloc(MAX_CMD_LENGTH);
-	}
+	char *words[MAX_WORDS];
 
 	// Prompt user for input
 	printf("$");
+	flush_console();
 	if (fgets(cmd, MAX_CMD_LENGTH, stdin) == NULL) {
 		printf("Piping completed restoring console inputs...\n");
 		stdin = fopen("/dev/tty", "rb");
 		return 0;
 	}
 
-	// Obtain the trimmed command, i.e. trailing and leading whitespaces
-	// removed from the input string
-	trimmed_cmd_len = trim(cmd, strlen(cmd), trimmed_cmd);
-
-	// Send user input to the parser function and return the status code
-	if (trimmed_cmd_len > 0) {
-		num_of_words = parser(trimmed_cmd, words);
-	} else {
-		// User entered an empty command
-		num_of_words = 0;
-	}
+	// Split the command in place, leading and trailing whitespaces are
+	// dropped
+	num_of_words = tokenize(cmd, words, MAX_WORDS);
 
 	if (num_of_words > 0) {
 		err = interpret(words, num_of_words, NULL, 0);
@@ -75,13 +63,56 @@ int prompt_command() {
 		err = -21;
 	}
 
-	for (i = 0; i < (MAX_CMD_LENGTH / 2); i++) {
-		free(words[i]);
-	}
-	free(words);
 	return err;
 }
 
+/* ----------------------------------------------------------------------------
+ * @brief Splits a line into words in place. Spaces and the trailing newline
+ *        are overwritten with null characters and the words point into the
+ *        line, so no memory is allocated or copied. Produces the same words
+ *        as trim followed by parser.
+ * @param input  - line       A null-terminated line (destroyed)
+ *        output - words      An array of pointers into the line
+ *        input  - max_words  Capacity of the words array
+ * @return int - number of words found or status code
+ *               >= 0 - Number of words
+ *                 -1 - Input line is null
+ *                 -2 - Output words is null
+ * ----------------------------------------------------------------------------
+ */
+int tokenize(char *line, char **words, int max_words) {
+	int i = 0;
+
+	// Check if input line is null
+	if (!line) {
+		return -1;
+	}
+
+	// Check if output has a valid pointer
+	if (!words) {
+		return -2;
+	}
+
+	while (*line && i < max_words) {
+		// Skip delimiters before the word
+		while (*line == ' ' || *line == '\n') {
+			*line++ = '\0';
+		}
+		if (!*line) {
+			break;
+		}
+
+		// Record the start of the word and skip to its end
+		words[i++] = line;
+		while (*line && *line != ' ' && *line != '\n') {
+			line++;
+		}
+	}
+
+	// Returns number of words found
+	return i;
+}
+
 /* ----------------------------------------------------------------------------
  * @brief Removes leading and trailing whitespaces from an input string.
  * @param input  - str          A string to trim
@@ -13,6 +13,7 @@
  * Available functions from shell
  */
 int prompt_command();
+int tokenize(char *line, char **words, int max_words);
 int trim(const char *str, int str_size, char *trimmed_str);
 int parser(const char *str, char **words);
 int handle_error(int err);
@@ -1,28 +1,40 @@
 /* ----------------------------------------------------------------------------
  * @file SHELLMEMORY.C
  * @author Si Xun Li - 260674916
- * @version 2.0
+ * @version 3.0
  * @brief This file contains all functions related to the shell memory.
+ *        Variables are kept in a doubly linked list to preserve the positional
+ *        semantics of the interface and are indexed by an open-addressing hash
+ *        table so that lookups by key are O(1) on average. Nodes and values are
+ *        allocated from the arena at their real length, with the key stored
+ *        inline after its node.
  * ----------------------------------------------------------------------------
  */
 
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <pthread.h>
 #include "constant.h"
+#include "arena.h"
 #include "shellmemory.h"
 
 /*
- * Declare singly linked list data structure
+ * Declare linked list and hash table data structures
  * These will be private and only accessible within this file.
  */
 typedef struct node node_t;
 typedef struct linked_list linked_list_t;
+typedef struct hash_slot hash_slot_t;
+typedef struct hash_table hash_table_t;
 
 struct node {
-	char *key;
 	char *value;
+	size_t value_size;
+	unsigned int hash;
 	node_t *next;
+	node_t *previous;
+	char key[];
 };
 
 struct linked_list {
@@ -30,23 +42,228 @@ struct linked_list {
 	unsigned int size;
 };
 
+struct hash_slot {
+	node_t *node;
+	unsigned int hash;
+};
+
+struct hash_table {
+	hash_slot_t *slots;
+	unsigned int capacity;
+	unsigned int used;
+};
+
 /*
- * Private linked list
+ * Private linked list and its index
  */
 linked_list_t *list;
+hash_table_t *table;
+
+/*
+ * Marks a slot whose node was removed so that probing continues past it
+ */
+node_t tombstone;
+
+/*
+ * Guards the list, the table and the arena against concurrent CPUs
+ */
+pthread_mutex_t memory_lock = PTHREAD_MUTEX_INITIALIZER;
 
 /*
- * Private function for debugging purposes
+ * Private functions
  */
 void print_node(node_t *node);
+void free_node(node_t *node);
+unsigned int hash_key(char *key);
+int find_slot(char *key, unsigned int hash);
+int index_node(node_t *node);
+int grow_table();
+node_t *make_node(char *key, char *value);
 
 
 /* ----------------------------------------------------------------------------
- * @brief Initialize the linked list.
+ * @brief Initialize the linked list and the hash table.
  * ----------------------------------------------------------------------------
  */
 void init_shell_memory () {
-	list = (linked_list_t *) malloc(sizeof(linked_list_t));
+	init_arena();
+	list = (linked_list_t *) calloc(1, sizeof(linked_list_t));
+	table = (hash_table_t *) calloc(1, sizeof(hash_table_t));
+	if (table) {
+		table->slots = (hash_slot_t *) calloc(HASH_INITIAL_CAPACITY,
+		                                      sizeof(hash_slot_t));
+		table->capacity = table->slots ? HASH_INITIAL_CAPACITY : 0;
+	}
+}
+
+/* ----------------------------------------------------------------------------
+ * @brief Hashes a key using FNV-1a.
+ * @param input  - key  A null-terminated string
+ * @return The 32-bit hash of the key
+ * ----------------------------------------------------------------------------
+ */
+unsigned int hash_key (char *key) {
+	unsigned int hash = 2166136261u;
+	while (*key) {
+		hash ^= (unsigned char) *key++;
+		hash *= 16777619u;
+	}
+	return hash;
+}
+
+/* ----------------------------------------------------------------------------
+ * @brief Finds the slot holding a key using linear probing.
+ * @param input  - key   A string key
+ *        input  - hash  The hash of the key
+ * @return The slot holding the key. -1 if the key is not indexed
+ * ----------------------------------------------------------------------------
+ */
+int find_slot (char *key, unsigned int hash) {
+	unsigned int i, mask;
+	hash_slot_t *slot;
+
+	if (!table || table->capacity == 0) {
+		return -1;
+	}
+
+	mask = table->capacity - 1;
+	for (i = hash & mask; ; i = (i + 1) & mask) {
+		slot = &table->slots[i];
+		if (!slot->node) {
+			// An empty slot ends the probe sequence
+			return -1;
+		}
+		if (slot->node != &tombstone && slot->hash == hash &&
+		    strcmp(slot->node->key, key) == 0) {
+			return i;
+		}
+	}
+}
+
+/* ----------------------------------------------------------------------------
+ * @brief Adds a node to the hash table. The table is grown beforehand if the
+ *        load factor would be exceeded.
+ * @param input  - node  A node that is not yet indexed
+ * @return int - Status code
+ *                  0 - No errors
+ *                 -6 - Could not allocate new memory space
+ * ----------------------------------------------------------------------------
+ */
+int index_node (node_t *node) {
+	unsigned int i, mask;
+
+	// Tombstones count towards the load so that probes always terminate
+	if ((table->used + 1) * HASH_LOAD_FACTOR_DEN >
+	    table->capacity * HASH_LOAD_FACTOR_NUM) {
+		if (grow_table() != 0) {
+			return -6;
+		}
+	}
+
+	mask = table->capacity - 1;
+	for (i = node->hash & mask; ; i = (i + 1) & mask) {
+		if (!table->slots[i].node) {
+			table->used++;
+			break;
+		}
+		if (table->slots[i].node == &tombstone) {
+			// Reuse the tombstone, the load does not change
+			break;
+		}
+	}
+	table->slots[i].node = node;
+	table->slots[i].hash = node->hash;
+	return 0;
+}
+
+/* ----------------------------------------------------------------------------
+ * @brief Doubles the capacity of the hash table and rehashes every node.
+ *        Tombstones are dropped in the process.
+ * @return int - Status code
+ *                  0 - No errors
+ *                 -6 - Could not allocate new memory space
+ * ----------------------------------------------------------------------------
+ */
+int grow_table () {
+	unsigned int i, j, mask, capacity;
+	hash_slot_t *slots;
+
+	capacity = table->capacity ? table->capacity : HASH_INITIAL_CAPACITY;
+	// Only grow if live nodes alone would exceed the load factor
+	while ((list->size + 1) * HASH_LOAD_FACTOR_DEN >
+	       capacity * HASH_LOAD_FACTOR_NUM / 2) {
+		capacity = capacity << 1;
+	}
+
+	slots = (hash_slot_t *) calloc(capacity, sizeof(hash_slot_t));
+	if (!slots) {
+		return -6;
+	}
+
+	mask = capacity - 1;
+	table->used = 0;
+	for (i = 0; i < table->capacity; i++) {
+		if (!table->slots[i].node || table->slots[i].node == &tombstone) {
+			continue;
+		}
+		for (j = table->slots[i].hash & mask; slots[j].node;
+		     j = (j + 1) & mask);
+		slots[j] = table->slots[i];
+		table->used++;
+	}
+
+	free(table->slots);
+	table->slots = slots;
+	table->capacity = capacity;
+	return 0;
+}
+
+/* ----------------------------------------------------------------------------
+ * @brief Allocates a node and copies the key and value into it.
+ * @param input  - key    A string key
+ *        input  - value  A string value
+ * @return A new unlinked node. NULL if memory could not be allocated
+ * ----------------------------------------------------------------------------
+ */
+node_t *make_node (char *key, char *value) {
+	size_t key_size = strlen(key) + 1;
+	size_t value_size = strlen(value) + 1;
+	node_t *new_node = (node_t *) arena_alloc(sizeof(node_t) + key_size);
+	char *new_value = (char *) arena_alloc(value_size);
+
+	// Check if memory is allocated
+	if (!new_node || !new_value) {
+		arena_free(new_node, sizeof(node_t) + key_size);
+		arena_free(new_value, value_size);
+		return NULL;
+	}
+
+	// Copy keys and values over
+	memcpy(new_node->key, key, key_size);
+	memcpy(new_value, value, value_size);
+
+	new_node->value = new_value;
+	new_node->value_size = value_size;
+	new_node->hash = hash_key(new_node->key);
+	new_node->next = NULL;
+	new_node->previous = NULL;
+
+	// Index the node before it becomes visible in the list
+	if (index_node(new_node) != 0) {
+		free_node(new_node);
+		return NULL;
+	}
+	return new_node;
+}
+
+/* ----------------------------------------------------------------------------
+ * @brief Returns a node and its value to the arena.
+ * @param input  - node  An unlinked node
+ * ----------------------------------------------------------------------------
+ */
+void free_node (node_t *node) {
+	arena_free(node->value, node->value_size);
+	arena_free(node, sizeof(node_t) + strlen(node->key) + 1);
 }
 
 /* ----------------------------------------------------------------------------
@@ -62,8 +279,10 @@ void init_shell_memory () {
  * ----------------------------------------------------------------------------
  */
 int insert_first (char *key, char *value) {
+	node_t *new_node;
+
 	// Checks if the linked list is null
-	if (!list) {
+	if (!list || !table) {
 		return -2;
 	}
 
@@ -77,30 +296,19 @@ int insert_first (char *key, char *value) {
 		return -1;
 	}
 
-	// Standard insertion technique for singly linked list
-	node_t *new_node = (node_t *) malloc(sizeof(node_t));
-	char *new_key = (char *) malloc(MAX_CMD_LENGTH);
-	char *new_value = (char *) malloc(MAX_CMD_LENGTH);
-
-	// Check if memory is allocated
-	if (new_node && new_key && new_value) {	
-		// Copy keys and values over
-		strncpy(new_key, key, strlen(key));
-		new_key[strlen(key)] = '\0';
-		strncpy(new_value, value, strlen(value));
-		new_value[strlen(value)] = '\0';
-
-		new_node->key = new_key;
-		new_node->value = new_value;
-		new_node->next = list->head;
-
-		
-		list->head = new_node;
-		list->size = list->size + 1;
+	new_node = make_node(key, value);
+	if (!new_node) {
+		return -6;
+	}
 
-		return 0;
+	new_node->next = list->head;
+	if (list->head) {
+		list->head->previous = new_node;
 	}
-	return -6;
+	list->head = new_node;
+	list->size = list->size + 1;
+
+	return 0;
 }
 
 /* ----------------------------------------------------------------------------
@@ -120,19 +328,16 @@ int insert_first (char *key, char *value) {
  */
 int insert (unsigned int position, char *key, char *value) {
 	unsigned int i;
-	unsigned int size;
 	node_t *current_node;
-	node_t *next_node;
+	node_t *new_node;
 
 	// Checks if list is null
-	if (!list) {
+	if (!list || !table) {
 		return -2;
 	}
 
-	size = list->size;
-
 	// Checks if position is in permissible bounds
-	if (position > size) {
+	if (position > list->size) {
 		return -3;
 	}
 
@@ -156,38 +361,28 @@ int insert (unsigned int position, char *key, char *value) {
 	}
 
 	// Create a new node
-	node_t *new_node = (node_t *) malloc(sizeof(node_t));
-	char *new_key = (char *) malloc(MAX_CMD_LENGTH);
-	char *new_value = (char *) malloc(MAX_CMD_LENGTH);
-
-	// Check if malloc has completed properly
-	if (new_node && new_key && new_value) {
-		// Copy key and value over
-		strncpy(new_key, key, strlen(key));
-		new_key[strlen(key)] = '\0';
-		strncpy(new_value, value, strlen(value));
-		new_value[strlen(value)] = '\0';
-
-		new_node->key = new_key;
-		new_node->value = new_value;
-
-		// Fetch the position where the new node is being inserted
-		current_node = list->head;
-		for (i = 0; i < position - 1; i++) {
-			current_node = current_node->next;
-		}
+	new_node = make_node(key, value);
+	if (!new_node) {
+		// Failed to allocate memory
+		return -6;
+	}
 
-		// Insert the node
-		next_node = current_node->next;
-		new_node->next = next_node;
-		current_node->next = new_node;
-		list->size = size + 1;
+	// Fetch the position where the new node is being inserted
+	current_node = list->head;
+	for (i = 0; i < position - 1; i++) {
+		current_node = current_node->next;
+	}
 
-		return 0;
+	// Insert the node
+	new_node->next = current_node->next;
+	new_node->previous = current_node;
+	if (current_node->next) {
+		current_node->next->previous = new_node;
 	}
+	current_node->next = new_node;
+	list->size = list->size + 1;
 
-	// Failed to allocate memory
-	return -6;
+	return 0;
 }
 
 /* ----------------------------------------------------------------------------
@@ -211,7 +406,7 @@ void print_traversal () {
 	for (i = 0; i < size; i++) {
 		printf("<Index: %d Key: %s Value: %s>\n", i,
 		       current_node->key, current_node->value);
-		current_node = current_node->next; 
+		current_node = current_node->next;
 	}
 }
 
@@ -240,13 +435,11 @@ void print_node (node_t *node) {
  * ----------------------------------------------------------------------------
  */
 int remove_node_by_key (char *key) {
-	int i;
-	int index;
-	node_t *previous_node;
+	int slot;
 	node_t *current_node;
 
 	// Checks if list is null
-	if (!list) {
+	if (!list || !table) {
 		return -2;
 	}
 
@@ -256,29 +449,26 @@ int remove_node_by_key (char *key) {
 	}
 
 	// Checks if the key is present
-	index = search(key);
+	slot = search(key);
 
-	if (index < 0) {
+	if (slot < 0) {
 		return -1;
 	}
 
-	// Take care of special case
-	if (index == 0) {
-		current_node = list->head;
-		list->head = current_node->next;
+	// Unlink the node from the list and the index
+	current_node = table->slots[slot].node;
+	table->slots[slot].node = &tombstone;
+	if (current_node->previous) {
+		current_node->previous->next = current_node->next;
 	} else {
-		previous_node = list->head;
-		for (i = 0; i < index - 1; i++) {
-			previous_node = previous_node->next;
-		}
-		current_node = previous_node->next;
-		previous_node->next = current_node->next;
+		list->head = current_node->next;
+	}
+	if (current_node->next) {
+		current_node->next->previous = current_node->previous;
 	}
 
 	// Free up allocated memory
-	free(current_node->value);
-	free(current_node->key);
-	free(current_node);
+	free_node(current_node);
 
 	list->size = list->size - 1;
 	return 0;
@@ -298,11 +488,12 @@ int remove_node_by_key (char *key) {
  * ----------------------------------------------------------------------------
  */
 int update_value_by_key (char *key, char *value) {
-	int i;
-	int index;
+	int slot;
+	size_t value_size;
+	char *new_value;
 	node_t *current_node;
 	// Checks if list is null
-	if (!list) {
+	if (!list || !table) {
 		return -2;
 	}
 
@@ -316,19 +507,16 @@ int update_value_by_key (char *key, char *value) {
 		return -4;
 	}
 
-	index = search(key); 
-	if (index >= 0) {
+	slot = search(key);
+	if (slot >= 0) {
 		// Update value
-		current_node = list->head;
-		for (i = 0; i < index; i++) {
-			current_node = current_node->next;
-		}
-
-		// Free up previous value
-		free(current_node->value);
+		current_node = table->slots[slot].node;
 
-		// Allocate new value resource
-		char *new_value = (char *) malloc(MAX_CMD_LENGTH);
+		// Reuse the previous value block if the new value fits its class
+		value_size = strlen(value) + 1;
+		new_value = (char *) arena_resize(current_node->value,
+		                                  current_node->value_size,
+		                                  value_size);
 
 		// Failed to allocate resource
 		if (!new_value) {
@@ -336,9 +524,9 @@ int update_value_by_key (char *key, char *value) {
 		}
 
 		// Copy over new value
-		strncpy(new_value, value, strlen(value));
-		new_value[strlen(value)] = '\0';
+		memcpy(new_value, value, value_size);
 		current_node->value = new_value;
+		current_node->value_size = value_size;
 		return 0;
 	} else {
 		return -1;
@@ -367,7 +555,7 @@ int get_value (unsigned int position, char *output_value) {
 		output_value = NULL;
 		return -1;
 	}
-	
+
 	size = list->size;
 
 	// Check if position is contained in bounds
@@ -392,11 +580,11 @@ int get_value (unsigned int position, char *output_value) {
 }
 
 /* ----------------------------------------------------------------------------
- * @brief Searches the linked list for the value where the key was found. If
- *        the key was found, return the index and value.
+ * @brief Searches the hash table for the value where the key was found. If
+ *        the key was found, return the slot and value.
  * @param input  - key           A key to find
  *        output - output_value  A string value to return
- * @return int - Returns the index where the key was found or status code.
+ * @return int - Returns the slot where the key was found or status code.
  *                 -1 - Key was not found
  *                 -2 - list is null
  *                 -3 - key is null
@@ -404,12 +592,11 @@ int get_value (unsigned int position, char *output_value) {
  * ----------------------------------------------------------------------------
  */
 int get_value_by_key (char *key, char *output_value) {
-	int i;
+	int slot;
 	node_t *current_node;
-	int size;
 
 	// Checks if the list is null
-	if (!list) {
+	if (!list || !table) {
 		return -2;
 	}
 
@@ -423,18 +610,11 @@ int get_value_by_key (char *key, char *output_value) {
 		return -4;
 	}
 
-	size = list->size;
-
-	if (size != 0) {
-		current_node = list->head;
-		for (i = 0; i < size; i++) {
-			if (strcmp(current_node->key, key) == 0) {
-				strncpy(output_value, current_node->value, strlen(current_node->value));
-				output_value[strlen(current_node->value)] = '\0';
-				return i;
-			}
-			current_node = current_node->next;
-		}
+	slot = find_slot(key, hash_key(key));
+	if (slot >= 0) {
+		current_node = table->slots[slot].node;
+		strcpy(output_value, current_node->value);
+		return slot;
 	}
 	output_value[0] = '\0';
 	return -1;
@@ -442,24 +622,19 @@ int get_value_by_key (char *key, char *output_value) {
 
 /*
  * ----------------------------------------------------------------------------
- * @brief Searches a linked list to see if a key exists. O(n) performance.
- *        Could be improved by using a self-sorting tree structure such as AVL
- *        trees. However, for the sake of this assignment, it is not needed.
- * @param input  - list   A linked list to check
- *        input  - key    A string to check if it exists in the linked list
- * @return int - Returns the index where the key was found or a status code.
+ * @brief Searches the hash table to see if a key exists. O(1) on average.
+ *        The returned slot is only valid until the next insertion since the
+ *        table may be rehashed when it grows.
+ * @param input  - key    A string to check if it exists in the shell memory
+ * @return int - Returns the slot where the key was found or a status code.
  *                 -1 - Key was not found
  *                 -2 - list is null
  *                 -3 - key is null
  * ----------------------------------------------------------------------------
  */
 int search (char *key) {
-	int i;
-	node_t *current_node;
-	int size;
-
 	// Checks if list is null
-	if (!list) {
+	if (!list || !table) {
 		return -2;
 	}
 
@@ -468,18 +643,58 @@ int search (char *key) {
 		return -3;
 	}
 
-	// Linear search
-	size = list->size;
-	if (size != 0) {
-//		printf("Searching... Entered size: %d ", list->size); //
-		current_node = list->head;
-		for (i = 0; i < size; i++) {
-//			printf("Current node: %s Key: %s\n", current_node->key, key); //
-			if (strcmp(current_node->key, key) == 0) {
-				return i;
-			}
-			current_node = current_node->next;
-		}
-	}
-	return -1;
+	return find_slot(key, hash_key(key));
+}
+
+/* ----------------------------------------------------------------------------
+ * @brief Prints the footprint of the shell memory. Live bytes are the bytes
+ *        requested for nodes, keys and values. Wasted bytes are reserved but
+ *        not live: rounding up to a size class, blocks waiting on a free list
+ *        and the untouched tail of chunks.
+ * ----------------------------------------------------------------------------
+ */
+void print_memory_stats () {
+	arena_stats_t stats;
+	size_t table_bytes = 0;
+	unsigned int size = 0;
+
+	arena_get_stats(&stats);
+	if (list) {
+		size = list->size;
+	}
+	if (table) {
+		table_bytes = table->capacity * sizeof(hash_slot_t);
+	}
+
+	printf("Variables:      %u\n"
+	       "Bytes live:     %zu\n"
+	       "Bytes wasted:   %zu (rounding %zu, free lists %zu, unused %zu)\n"
+	       "Bytes reserved: %zu\n"
+	       "Blocks reused:  %zu\n"
+	       "Index bytes:    %zu\n",
+	       size,
+	       stats.bytes_live,
+	       stats.bytes_rounding + stats.bytes_free_listed + stats.bytes_unused,
+	       stats.bytes_rounding, stats.bytes_free_listed, stats.bytes_unused,
+	       stats.bytes_reserved,
+	       stats.blocks_reused,
+	       table_bytes);
+}
+
+/* ----------------------------------------------------------------------------
+ * @brief Acquires the shell memory. Must be held across every call into the
+ *        shell memory, including sequences such as an insert followed by an
+ *        update, when several CPUs are running.
+ * ----------------------------------------------------------------------------
+ */
+void lock_shell_memory() {
+	pthread_mutex_lock(&memory_lock);
+}
+
+/* ----------------------------------------------------------------------------
+ * @brief Releases the shell memory.
+ * ----------------------------------------------------------------------------
+ */
+void unlock_shell_memory() {
+	pthread_mutex_unlock(&memory_lock);
 }
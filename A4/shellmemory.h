@@ -1,14 +1,14 @@
 /* ----------------------------------------------------------------------------
  * @file SHELLMEMORY.H
  * @author Si Xun Li - 260674916
- * @version 2.0
- * @brief This file is the header for shell memory. It also declares the
- *        linked list data structure.
+ * @version 3.0
+ * @brief This file is the header for shell memory. Variables are stored in a
+ *        linked list indexed by a hash table.
  * ----------------------------------------------------------------------------
  */
 
 /*
- * Supported functions for singly linked list
+ * Supported functions for shell memory
  */
 void init_shell_memory();
 int insert_first(char *key, char *value);
@@ -19,3 +19,6 @@ int update_value_by_key(char *key, char *value);
 int get_value(unsigned int position, char *output_value);
 int get_value_by_key(char *key, char *output_value);
 int search(char *key);
+void print_memory_stats();
+void lock_shell_memory();
+void unlock_shell_memory();